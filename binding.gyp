@@ -39,6 +39,9 @@
         "src/env.cpp",
         "src/compression.cpp",
         "src/ordered-binary.cpp",
+        "src/value-log.cpp",
+        "src/value-cache.cpp",
+        "src/extended-dbi.cpp",
         "src/misc.cpp",
         "src/txn.cpp",
         "src/dbi.cpp",
@@ -1,10 +1,21 @@
-import { WeakLRUCache, clearKeptObjects } from './native.js';
+import { WeakLRUCache, clearKeptObjects, getCommitFeed } from './native.js';
 import { FAILED_CONDITION, ABORT, IF_EXISTS } from './write.js';
 import { UNMODIFIED } from './read.js';
 import { when } from './util/when.js';
 
 let getLastVersion, getLastTxnId;
 const mapGet = Map.prototype.get;
+const mapKeys = Map.prototype.keys;
+// must match the layout of the native commit feed
+const COMMIT_FEED_ENTRIES = 0x4000;
+const COMMIT_FEED_TXN = 0xffffffff;
+const COMMIT_FEED_PUBLISHED_TXN = 1;
+const COMMIT_FEED_COMMITTING_TXN = 2;
+const COMMIT_FEED_HEADER = 4;
+const hashBuffer =
+	typeof Buffer != 'undefined'
+		? Buffer.allocUnsafeSlow(0x1000)
+		: new Uint8Array(0x1000);
 export const CachingStore = (Store, env) => {
 	let childTxnChanges;
 	return class LMDBStore extends Store {
@@ -37,6 +48,23 @@ export const CachingStore = (Store, env) => {
 				options.cache.clearKeptObjects = clearKeptObjects;
 			this.cache = new WeakLRUCache(options.cache);
 			if (options.cache.validated) this.cache.validated = true;
+			else if (options.cache.invalidated) {
+				// cached entries are invalidated from the keys that each txn (from any thread in this process) wrote
+				if (!env.commitFeed) {
+					let [feed, lastTxnId] = getCommitFeed(env.address);
+					env.commitFeed = new Uint32Array(feed);
+					// the (low word of the) id of the last txn committed by any process, to see commits that weren't published
+					env.lastCommittedTxnId = lastTxnId ? new Uint32Array(lastTxnId, 0, 1) : new Uint32Array(1);
+					env.txnIdChecked = env.lastCommittedTxnId[0];
+					env.feedConsumed = env.commitFeed[0];
+					// the current read txn may predate anything we consume, so don't cache from it
+					env.readTxnFeedPosition = env.feedConsumed - 1;
+					env.invalidatedStores = [];
+				}
+				env.invalidatedStores[this.db.dbi] = this;
+				this.cache.invalidated = true;
+				this.keyHashes = new Map();
+			}
 		}
 		get isCaching() {
 			return true;
@@ -59,6 +87,7 @@ export const CachingStore = (Store, env) => {
 			} else if (options && options.transaction) {
 				return super.get(id, options);
 			} else {
+				if (this.cache.invalidated) consumeCommitFeed(env);
 				value = this.cache.getValue(id);
 				if (value !== undefined) {
 					return value;
@@ -71,6 +100,10 @@ export const CachingStore = (Store, env) => {
 				!options &&
 				typeof id !== 'object'
 			) {
+				if (this.cache.invalidated) {
+					if (!canCacheRead(env)) return value;
+					this.trackKey(id);
+				}
 				let entry = this.cache.setValue(id, value, this.lastSize >> 10);
 				if (this.useVersions) {
 					entry.version = getLastVersion();
@@ -96,6 +129,7 @@ export const CachingStore = (Store, env) => {
 			} else if (options && options.transaction) {
 				return super.getEntry(id, options);
 			} else {
+				if (this.cache.invalidated) consumeCommitFeed(env);
 				entry = this.cache.get(id);
 				if (entry !== undefined) {
 					return entry;
@@ -103,7 +137,13 @@ export const CachingStore = (Store, env) => {
 				value = super.get(id);
 			}
 			if (value === undefined) return;
-			if (value && typeof value === 'object' && typeof id !== 'object') {
+			if (
+				value &&
+				typeof value === 'object' &&
+				typeof id !== 'object' &&
+				!(this.cache.invalidated && !canCacheRead(env))
+			) {
+				if (this.cache.invalidated) this.trackKey(id);
 				entry = this.cache.setValue(id, value, this.lastSize >> 10);
 			} else entry = { value };
 			if (this.useVersions) entry.version = getLastVersion();
@@ -113,6 +153,7 @@ export const CachingStore = (Store, env) => {
 		putEntry(id, entry, ifVersion) {
 			let result = super.put(id, entry.value, entry.version, ifVersion);
 			if (typeof id === 'object') return result;
+			if (this.cache.invalidated) this.trackKey(id);
 			if (result && result.then)
 				this.cache.setManually(id, entry); // set manually so we can keep it pinned in memory until it is committed
 			// sync operation, immediately add to cache
@@ -142,6 +183,7 @@ export const CachingStore = (Store, env) => {
 						} // sync failure
 						// otherwise keep it pinned in memory until it is committed
 					} else entry = this.cache.setValue(id, value, -1);
+					if (this.cache.invalidated) this.trackKey(id);
 				}
 				if (childTxnChanges) childTxnChanges.add(id);
 				if (version !== undefined && entry)
@@ -161,6 +203,7 @@ export const CachingStore = (Store, env) => {
 					result
 				) {
 					let entry = this.cache.setValue(id, value);
+					if (this.cache.invalidated) this.trackKey(id);
 					if (childTxnChanges) childTxnChanges.add(id);
 					if (version !== undefined) {
 						entry.version =
@@ -215,6 +258,7 @@ export const CachingStore = (Store, env) => {
 			});
 		}
 		doesExist(key, versionOrValue) {
+			if (this.cache.invalidated) consumeCommitFeed(env);
 			let entry = this.cache.get(key);
 			if (entry) {
 				if (versionOrValue == null) {
@@ -227,8 +271,95 @@ export const CachingStore = (Store, env) => {
 			}
 			return super.doesExist(key, versionOrValue);
 		}
+		// record the hash of the key (as the writer computes it), so commits of the key can find the cached entry
+		trackKey(id) {
+			let keyHashes = this.keyHashes;
+			if (keyHashes.size > (this.cache.size << 1) + 0x400) {
+				// drop the hashes of entries that have since been evicted
+				keyHashes.clear();
+				for (let cachedId of mapKeys.call(this.cache))
+					this.trackKeyHash(cachedId, hashKey(this, cachedId));
+			}
+			this.trackKeyHash(id, hashKey(this, id));
+		}
+		trackKeyHash(id, hash) {
+			let ids = this.keyHashes.get(hash);
+			if (ids === undefined) this.keyHashes.set(hash, id);
+			else if (Array.isArray(ids)) {
+				if (!ids.includes(id)) ids.push(id);
+			} else if (ids !== id) this.keyHashes.set(hash, [ids, id]);
+		}
+		invalidate(hash, txnId) {
+			if (hash === 0) return this.clearCachedEntries(); // dropped or cleared db
+			let ids = this.keyHashes.get(hash);
+			if (ids === undefined) return;
+			this.keyHashes.delete(hash);
+			if (Array.isArray(ids)) {
+				for (let id of ids) this.invalidateId(id, hash, txnId);
+			} else this.invalidateId(ids, hash, txnId);
+		}
+		invalidateId(id, hash, txnId) {
+			let entry = mapGet.call(this.cache, id);
+			// keep entries that we put ourselves, in the txn that was committed
+			if (entry && txnId !== undefined && entry.txnId === txnId)
+				this.trackKeyHash(id, hash);
+			else this.cache.delete(id);
+		}
+		clearCachedEntries() {
+			this.cache.clear();
+			this.keyHashes.clear();
+		}
 	};
 };
+function hashKey(store, id) {
+	// FNV-1a of the key bytes
+	let end = store.writeKey(id, hashBuffer, 0);
+	let hash = 0x811c9dc5;
+	for (let i = 0; i < end; i++) hash = Math.imul(hash ^ hashBuffer[i], 0x01000193);
+	return hash >>> 0;
+}
+// apply the invalidations that have been published since we last looked, a couple of reads if there are none
+function consumeCommitFeed(env) {
+	if (!env.address) return; // closed, the feed and the lock file may be unmapped
+	let feed = env.commitFeed;
+	let position = feed[0];
+	let consumed = env.feedConsumed;
+	let lastTxnId = env.lastCommittedTxnId[0];
+	if (lastTxnId !== env.txnIdChecked) checkUnpublishedCommits(env, lastTxnId);
+	if (position === consumed) return;
+	let missed = (position - consumed) >>> 0 > COMMIT_FEED_ENTRIES;
+	if (!missed) {
+		let txnId;
+		for (let i = consumed; i !== position; i = (i + 1) >>> 0) {
+			let index = COMMIT_FEED_HEADER + ((i & (COMMIT_FEED_ENTRIES - 1)) << 1);
+			let dbi = feed[index];
+			if (dbi === COMMIT_FEED_TXN) txnId = feed[index + 1];
+			else env.invalidatedStores[dbi]?.invalidate(feed[index + 1], txnId);
+		}
+		// the writer may have lapped us while we were reading
+		missed = (feed[0] - consumed) >>> 0 > COMMIT_FEED_ENTRIES;
+	}
+	if (missed) {
+		for (let store of env.invalidatedStores) store?.clearCachedEntries();
+	}
+	env.feedConsumed = position;
+}
+// a txn committed by another process (or without its keys being recorded) doesn't publish which keys it wrote
+function checkUnpublishedCommits(env, lastTxnId) {
+	let feed = env.commitFeed;
+	if (((lastTxnId - feed[COMMIT_FEED_PUBLISHED_TXN]) | 0) > 0) {
+		// a txn of this process that has been committed, but not published yet, is fine, its keys are coming
+		if (lastTxnId === feed[COMMIT_FEED_COMMITTING_TXN]) return;
+		for (let store of env.invalidatedStores) store?.clearCachedEntries();
+		// and nothing can be cached from the current read txn, it may predate the commit
+		env.readTxnFeedPosition = env.feedConsumed - 1;
+	}
+	env.txnIdChecked = lastTxnId;
+}
+// a value read can only be cached if no invalidation it predates has been consumed already
+function canCacheRead(env) {
+	return env.writeTxn || ((env.feedConsumed - env.readTxnFeedPosition) | 0) <= 0;
+}
 export function setGetLastVersion(get, getTxnId) {
 	getLastVersion = get;
 	getLastTxnId = getTxnId;
@@ -378,6 +378,10 @@ typedef void (MDB_sum_func)(const MDB_val *src, MDB_val *dst, const MDB_val *key
 #define MDB_SAFE_RESTORE	0x800
 	/** Track metrics for this env */
 #define MDB_TRACK_METRICS	0x400
+	/** With #MDB_OVERLAPPINGSYNC, write out just the file ranges of the txns
+	 *	being synced before the fdatasync (Linux only)
+	 */
+#define MDB_SYNC_RANGES	0x200
 	/** Use the overlapping sync strategy */
 #define MDB_OVERLAPPINGSYNC_SYNC = 0x02
 /** @} */
@@ -555,6 +559,10 @@ typedef struct MDB_metrics {
 	uint64_t time_start_txns;
 	uint64_t time_page_flushes;
 	uint64_t time_sync;
+	mdb_size_t syncs; /* fsyncs (or msyncs) of the data file */
+	mdb_size_t synced_txns; /* txns that were synced when committed */
+	mdb_size_t uring_writes; /* page writes submitted through io_uring */
+	mdb_size_t range_syncs; /* overlapping syncs that wrote out the ranges of their txns first */
 } MDB_metrics;
 
 /** @brief Statistics for a database in the environment */
@@ -1068,9 +1076,18 @@ int  mdb_env_set_assert(MDB_env *env, MDB_assert_func *func);
 //<lmdb-js>
 typedef int (MDB_check_fd)(const mdb_filehandle_t fd, MDB_env* env);
 typedef void (MDB_txn_visible)(const void* ctx, int finished);
+/** Called before the data file is synced for a txn (including the flush of overlapping sync txns),
+ * so files the txns reference can be synced first. A non-zero return fails the sync. */
+typedef int (MDB_sync_func)(MDB_env* env);
 int mdb_env_set_callback(MDB_env *env, MDB_check_fd *func);
+int mdb_env_set_sync_callback(MDB_env *env, MDB_sync_func *func);
 int mdb_txn_set_callback(MDB_txn *txn, MDB_txn_visible *func, void* ctx);
 int	mdb_env_set_freespace_options(MDB_env *env, unsigned int max_to_load, unsigned int max_to_retain);
+int	mdb_txn_oldest(MDB_txn *txn, mdb_size_t *oldest);
+int	mdb_env_get_last_txnid(MDB_env *env, volatile mdb_size_t **last_txnid);
+int	mdb_txn_set_fill(MDB_txn *txn, unsigned int fill);
+int	mdb_txn_set_sync(MDB_txn *txn, int sync);
+int	mdb_cursor_readahead(MDB_cursor *mc, unsigned int max_pages);
 //</lmdb-js>
 
 #if MDB_RPAGE_CACHE
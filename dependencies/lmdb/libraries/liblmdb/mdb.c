@@ -133,6 +133,29 @@ extern int cacheflush(char *addr, int nbytes, int cache);
 #define	BROKEN_FDATASYNC
 #endif
 
+/* <lmdb-js> */
+#if defined(__linux__) && !defined(MDB_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+/** Submit the page writes of a commit through io_uring, with the data sync
+ *	queued behind them. The rings are driven with the raw syscalls, so there
+ *	is no dependency on liburing; if the kernel (or a seccomp policy) refuses
+ *	io_uring_setup, #mdb_page_flush() falls back to pwrite/writev.
+ */
+#define MDB_USE_IO_URING	1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#if defined(__linux__) && !defined(MDB_NO_SYNC_RANGES) && defined(SYNC_FILE_RANGE_WRITE)
+/** Overlapping syncs of an env opened with #MDB_SYNC_RANGES first wait on
+ *	the file ranges written by the txns they cover, with sync_file_range.
+ *	See #mdb_env_sync_range().
+ */
+#define MDB_USE_SYNC_RANGES	1
+#endif
+/* </lmdb-js> */
+
 #include <errno.h>
 #include <limits.h>
 #include <stddef.h>
@@ -1465,6 +1488,8 @@ struct MDB_txn {
 #define MDB_TXN_SPILLS		0x08		/**< txn or a parent has spilled pages */
 #define MDB_TXN_HAS_CHILD	0x10		/**< txn has an #MDB_txn.%mt_child */
 #define MDB_TXN_DIRTYNUM	0x20		/**< dirty list uses nump list */
+#define MDB_TXN_FLUSH_SYNC	0x40		/**< #mdb_page_flush() may sync the data it writes */
+#define MDB_TXN_SYNCED		0x80		/**< #mdb_page_flush() already synced the data */
 	/** most operations on the txn are currently illegal */
 #define MDB_TXN_BLOCKED		(MDB_TXN_FINISHED|MDB_TXN_ERROR|MDB_TXN_HAS_CHILD)
 /** @} */
@@ -1476,6 +1501,10 @@ struct MDB_txn {
 	 *	When #MDB_WRITEMAP, it is nonzero but otherwise irrelevant.
 	 */
 	unsigned int	mt_dirty_room;
+	/* <lmdb-js> */
+	/** Bytes to leave free in pages that are split by appends, see #mdb_txn_set_fill() */
+	unsigned int	mt_fill_reserve;
+	/* </lmdb-js> */
 };
 
 /** Enough space for 2^32 nodes with minimum of 2 keys per node. I.e., plenty.
@@ -1677,6 +1706,17 @@ struct MDB_env {
 	OVERLAPPED		*me_ov;			/**< Used for overlapping I/O requests */
 	int		me_ovs;				/**< Count of MDB_overlaps */
 #endif
+#ifdef MDB_USE_IO_URING
+	struct MDB_uring	*me_uring;	/**< io_uring for page writes, set up on first flush */
+#endif
+#ifdef MDB_USE_SYNC_RANGES
+	pthread_mutex_t	me_sr_mutex;	/**< protects the sync range list */
+	struct MDB_sync_range	*me_sr_list;	/**< ranges written by txns not yet synced */
+	unsigned	me_sr_count;	/**< number of entries in #me_sr_list */
+	unsigned	me_sr_size;		/**< allocated size of #me_sr_list */
+	txnid_t		me_sr_last;		/**< last txn that recorded its ranges */
+	txnid_t		me_sr_gap;		/**< txns up to this one may not be fully recorded */
+#endif
 #ifdef MDB_USE_POSIX_MUTEX	/* Posix mutexes reside in shared mem */
 #	define		me_rmutex	me_txns->mti_rmutex /**< Shared reader lock */
 #	define		me_wmutex	me_txns->mti_wmutex /**< Shared writer lock */
@@ -1708,6 +1748,7 @@ struct MDB_env {
 	MDB_metrics		me_metrics;	 /**< Metrics tracking */
 	MDB_assert_func *me_assert_func; /**< Callback for assertion failures */
 	void *me_callback; /**< General callback */
+	MDB_sync_func *me_sync_callback; /**< Called before the data file is synced */
 	int64_t 	boot_id;
 };
 
@@ -3304,6 +3345,135 @@ uint64_t get_time64() {
 }
 #endif
 
+/* <lmdb-js> */
+#ifdef MDB_USE_SYNC_RANGES
+	/** Max number of ranges kept before falling back to a full sync */
+#define MDB_SR_MAX	8192
+	/** Ranges closer than this are merged into one */
+#define MDB_SR_MERGE_GAP	0x10000
+
+	/** A range of the data file written by an overlapping sync txn */
+typedef struct MDB_sync_range {
+	txnid_t		sr_txnid;	/**< the latest txn that wrote into the range */
+	MDB_OFF_T	sr_start;
+	MDB_OFF_T	sr_end;
+} MDB_sync_range;
+
+/** Start recording the ranges a txn writes. Txns that were committed
+ *	without being recorded (by another process, or synced on their own)
+ *	leave a gap that only a full sync can cover.
+ */
+static void
+mdb_sync_range_begin(MDB_env *env, txnid_t txnid)
+{
+	pthread_mutex_lock(&env->me_sr_mutex);
+	if (txnid > env->me_sr_last + 1 && txnid - 1 > env->me_sr_gap)
+		env->me_sr_gap = txnid - 1;
+	env->me_sr_last = txnid;
+	pthread_mutex_unlock(&env->me_sr_mutex);
+}
+
+/** Record a run of pages written by a txn */
+static void
+mdb_sync_range_add(MDB_env *env, txnid_t txnid, MDB_OFF_T pos, size_t size)
+{
+	MDB_sync_range *sr;
+
+	pthread_mutex_lock(&env->me_sr_mutex);
+	if (env->me_sr_count) {
+		sr = &env->me_sr_list[env->me_sr_count - 1];
+		if (pos >= sr->sr_start && pos <= sr->sr_end + MDB_SR_MERGE_GAP) {
+			if (pos + (MDB_OFF_T)size > sr->sr_end)
+				sr->sr_end = pos + size;
+			if (txnid > sr->sr_txnid)
+				sr->sr_txnid = txnid;
+			goto done;
+		}
+	}
+	if (env->me_sr_count == env->me_sr_size) {
+		unsigned size = env->me_sr_size ? env->me_sr_size * 2 : 64;
+		if (size > MDB_SR_MAX ||
+			!(sr = realloc(env->me_sr_list, size * sizeof(MDB_sync_range)))) {
+			/* this txn's ranges are incomplete, it needs a full sync */
+			if (txnid > env->me_sr_gap)
+				env->me_sr_gap = txnid;
+			goto done;
+		}
+		env->me_sr_list = sr;
+		env->me_sr_size = size;
+	}
+	sr = &env->me_sr_list[env->me_sr_count++];
+	sr->sr_txnid = txnid;
+	sr->sr_start = pos;
+	sr->sr_end = pos + size;
+done:
+	pthread_mutex_unlock(&env->me_sr_mutex);
+}
+
+/** Write out the data of the txns up to \b txnid, by waiting on just the
+ * file ranges they wrote, so their pages are on the way to the disk before
+ * the pages written by later txns that are still being committed.
+ * sync_file_range doesn't flush the drive's cache or the file's metadata,
+ * so this is not a sync: #mdb_env_sync0() still has to follow it before the
+ * meta page can be flushed.
+ * The caller must hold the sync mutex.
+ * @return 0 on success, #MDB_NOTFOUND if the ranges don't cover these txns,
+ *	or an error.
+ */
+static int
+mdb_env_sync_range(MDB_env *env, txnid_t txnid)
+{
+	MDB_sync_range *list, *sr = NULL;
+	unsigned i, j, n = 0;
+	int rc = MDB_NOTFOUND;
+
+	pthread_mutex_lock(&env->me_sr_mutex);
+	list = env->me_sr_list;
+	if ((env->me_flags & MDB_SYNC_RANGES) && !(env->me_flags & (MDB_WRITEMAP|MDB_NOSYNC)) &&
+		env->me_sr_gap <= env->me_synced_txn_id && env->me_sr_last >= txnid) {
+		if (!env->me_sr_count || (sr = malloc(env->me_sr_count * sizeof(MDB_sync_range))))
+			rc = MDB_SUCCESS;
+	}
+	/* take out the ranges being written (or dropped, if they don't cover the txns) */
+	for (i = j = 0; i < env->me_sr_count; i++) {
+		if (list[i].sr_txnid <= txnid) {
+			if (sr)
+				sr[n++] = list[i];
+		} else
+			list[j++] = list[i];
+	}
+	env->me_sr_count = j;
+	pthread_mutex_unlock(&env->me_sr_mutex);
+
+	/* start writeback of every range first, then wait on them */
+	for (i = 0; i < n; i++)
+		sync_file_range(env->me_fd, sr[i].sr_start, sr[i].sr_end - sr[i].sr_start,
+			SYNC_FILE_RANGE_WRITE);
+	for (i = 0; i < n && !rc; i++) {
+		while (sync_file_range(env->me_fd, sr[i].sr_start, sr[i].sr_end - sr[i].sr_start,
+			SYNC_FILE_RANGE_WAIT_BEFORE|SYNC_FILE_RANGE_WRITE|SYNC_FILE_RANGE_WAIT_AFTER)) {
+			rc = ErrCode();
+			if (rc != EINTR)
+				break;
+			rc = 0;
+		}
+	}
+	free(sr);
+	if (!rc && (env->me_flags & MDB_TRACK_METRICS))
+		env->me_metrics.range_syncs++;
+	if (rc) {
+		/* the ranges are gone, so these txns can only be covered by a full sync */
+		pthread_mutex_lock(&env->me_sr_mutex);
+		if (txnid > env->me_sr_gap)
+			env->me_sr_gap = txnid;
+		pthread_mutex_unlock(&env->me_sr_mutex);
+	}
+	return rc;
+}
+#endif
+
+/* </lmdb-js> */
+
 int
 mdb_env_sync0(MDB_env *env, int force, pgno_t numpgs)
 {
@@ -3335,10 +3505,34 @@ mdb_env_sync0(MDB_env *env, int force, pgno_t numpgs)
 			if (MDB_FDATASYNC(env->me_fd))
 				rc = ErrCode();
 		}
+		if (env->me_flags & MDB_TRACK_METRICS) // <lmdb-js>
+			env->me_metrics.syncs++;
 	}
 	return rc;
 }
 
+/* <lmdb-js> */
+/** Sync the data of the txns up to \b txnid for an overlapping sync.
+ * With #MDB_SYNC_RANGES their ranges are written out first, but the
+ * #mdb_env_sync0() that flushes the drive's cache and the file's metadata
+ * always follows, since the flushed meta page must not reach the disk
+ * before the pages it points to.
+ */
+static int
+mdb_env_sync_txns(MDB_env *env, int force, txnid_t txnid, pgno_t numpgs)
+{
+	int rc;
+	if (env->me_sync_callback && (rc = env->me_sync_callback(env)))
+		return rc;
+#ifdef MDB_USE_SYNC_RANGES
+	rc = mdb_env_sync_range(env, txnid);
+	if (rc && rc != MDB_NOTFOUND)
+		return rc;
+#endif
+	return mdb_env_sync0(env, force, numpgs);
+}
+/* </lmdb-js> */
+
 int
 mdb_env_sync(MDB_env *env, int force)
 {
@@ -3372,7 +3566,7 @@ mdb_env_sync(MDB_env *env, int force)
 			sync_txn.mt_txnid = last_txn_id = m->mm_txnid;
 			sync_txn.mt_next_pgno = m->mm_last_pg + 1;
 		} while(ti->mti_txnid != last_txn_id); // avoid race condition in copying data by verifying that this is updated
-		rc = mdb_env_sync0(env, force, sync_txn.mt_next_pgno);
+		rc = mdb_env_sync_txns(env, force, last_txn_id, sync_txn.mt_next_pgno);
 
 		if (rc) {
 			if (env->me_flags & MDB_TRACK_METRICS) {
@@ -3395,7 +3589,11 @@ mdb_env_sync(MDB_env *env, int force)
 		if (env->me_flags & MDB_TRACK_METRICS) {
 			start = get_time64();
 		}
-		int rc = mdb_env_sync0(env, force, m->mm_last_pg+1);
+		int rc = 0;
+		if (env->me_sync_callback && (force || !(env->me_flags & MDB_NOSYNC)))
+			rc = env->me_sync_callback(env);
+		if (!rc)
+			rc = mdb_env_sync0(env, force, m->mm_last_pg+1);
 		if (env->me_flags & MDB_TRACK_METRICS) {
 			env->me_metrics.time_sync += get_time64() - start;
 		}
@@ -3661,6 +3859,7 @@ mdb_txn_renew0(MDB_txn *txn)
 		txn->mt_child = NULL;
 		txn->mt_loose_pgs = NULL;
 		txn->mt_loose_count = 0;
+		txn->mt_fill_reserve = 0;
 		if (env->me_flags & MDB_WRITEMAP) {
 			txn->mt_workid = txn->mt_txnid;
 			txn->mt_dirty_room = 1;
@@ -3786,6 +3985,55 @@ mdb_txn_set_callback(MDB_txn *txn, MDB_txn_visible *func, void* ctx)
 	return MDB_SUCCESS;
 }
 
+/* <lmdb-js> */
+/** Report the oldest txnid that may still be referenced by a reader (or not yet synced),
+ * so that external storage freed by a write txn can be safely reclaimed. */
+int
+mdb_txn_oldest(MDB_txn *txn, mdb_size_t *oldest)
+{
+	if (!txn || !oldest || (txn->mt_flags & MDB_TXN_RDONLY))
+		return EINVAL;
+	*oldest = mdb_find_oldest(txn);
+	return MDB_SUCCESS;
+}
+
+/** Get the address of the id of the last committed txn in the lock file, which every process
+ * updates when it commits, so callers can watch for commits without starting a txn. */
+int
+mdb_env_get_last_txnid(MDB_env *env, volatile mdb_size_t **last_txnid)
+{
+	if (!env || !last_txnid || !env->me_txns)
+		return EINVAL;
+	*last_txnid = &env->me_txns->mti_txnid;
+	return MDB_SUCCESS;
+}
+
+/** Set how full (in percent) pages are left when they are split by #MDB_APPEND puts,
+ * so that a sorted bulk load can leave room for later inserts. */
+int
+mdb_txn_set_fill(MDB_txn *txn, unsigned int fill)
+{
+	if (!txn || (txn->mt_flags & MDB_TXN_RDONLY) || fill < 10 || fill > 100)
+		return EINVAL;
+	txn->mt_fill_reserve = (txn->mt_env->me_psize - PAGEHDRSZ) * (100 - fill) / 100;
+	return MDB_SUCCESS;
+}
+
+/** Set whether a write txn is synced when it is committed, overriding the flags it was begun with, so that
+ * the choice can be made once its writes are known. */
+int
+mdb_txn_set_sync(MDB_txn *txn, int sync)
+{
+	if (!txn || (txn->mt_flags & MDB_TXN_RDONLY) || txn->mt_parent)
+		return EINVAL;
+	if (sync)
+		txn->mt_flags &= ~MDB_TXN_NOSYNC;
+	else
+		txn->mt_flags |= MDB_TXN_NOSYNC;
+	return MDB_SUCCESS;
+}
+/* </lmdb-js> */
+
 int
 mdb_txn_begin(MDB_env *env, MDB_txn *parent, unsigned int flags, MDB_txn **ret)
 {
@@ -3857,6 +4105,7 @@ mdb_txn_begin(MDB_env *env, MDB_txn *parent, unsigned int flags, MDB_txn **ret)
 		}
 		txn->mt_txnid = parent->mt_txnid;
 		txn->mt_dirty_room = parent->mt_dirty_room;
+		txn->mt_fill_reserve = parent->mt_fill_reserve;
 		txn->mt_u.dirty_list[0].mid = 0;
 		txn->mt_spill_pgs = NULL;
 #if OVERFLOW_NOTYET
@@ -4506,6 +4755,315 @@ static int mdb_page_chk_checksum(MDB_env *env, MDB_page *mp, size_t size);
 static void mdb_page_set_checksum(MDB_env *env, MDB_page *mp, size_t size);
 #endif
 
+/* <lmdb-js> */
+#ifdef MDB_USE_IO_URING
+	/** Number of submission queue entries in the io_uring */
+#define MDB_URING_DEPTH	128
+	/** user_data of the data sync queued behind the page writes */
+#define MDB_URING_SYNC	((__u64)-1)
+
+	/** A run of pages queued for writing. The iovecs have to stay valid
+	 *	until the kernel has completed the write, so they are copied here.
+	 */
+typedef struct MDB_uring_write {
+	MDB_OFF_T	mw_pos;		/**< file offset of the run */
+	size_t		mw_size;	/**< total bytes in the run */
+	int			mw_n;		/**< number of iovecs */
+	struct iovec	mw_iov[MDB_COMMIT_PAGES];
+} MDB_uring_write;
+
+	/** State of the io_uring used by #mdb_page_flush() */
+typedef struct MDB_uring {
+	int			mu_fd;		/**< ring fd, or -1 if io_uring is unavailable */
+	unsigned	mu_queued;	/**< entries added since the last submit */
+	unsigned	mu_inflight;	/**< entries submitted but not completed */
+	unsigned	mu_used;	/**< number of #mu_writes in use */
+	unsigned	*mu_sq_head, *mu_sq_tail, *mu_sq_mask, *mu_sq_array;
+	unsigned	*mu_cq_head, *mu_cq_tail, *mu_cq_mask;
+	struct io_uring_sqe	*mu_sqes;
+	struct io_uring_cqe	*mu_cqes;
+	void		*mu_sq_ring, *mu_cq_ring;
+	size_t		mu_sq_size, mu_cq_size, mu_sqes_size;
+	/** one entry is left for the sync */
+	MDB_uring_write	mu_writes[MDB_URING_DEPTH - 1];
+} MDB_uring;
+
+/** Unmap and close the ring, leaving mu_fd as -1 so it isn't used again */
+static void
+mdb_uring_teardown(MDB_uring *ur)
+{
+	if (ur->mu_sqes)
+		munmap(ur->mu_sqes, ur->mu_sqes_size);
+	if (ur->mu_cq_ring)
+		munmap(ur->mu_cq_ring, ur->mu_cq_size);
+	if (ur->mu_sq_ring)
+		munmap(ur->mu_sq_ring, ur->mu_sq_size);
+	if (ur->mu_fd >= 0)
+		close(ur->mu_fd);
+	ur->mu_sqes = NULL;
+	ur->mu_cq_ring = ur->mu_sq_ring = NULL;
+	ur->mu_fd = -1;
+	ur->mu_queued = ur->mu_inflight = 0;
+}
+
+static void
+mdb_uring_close(MDB_uring *ur)
+{
+	if (!ur)
+		return;
+	mdb_uring_teardown(ur);
+	free(ur);
+}
+
+/** Set up the io_uring and map its rings.
+ * @return the ring state, with mu_fd of -1 if io_uring can't be used,
+ *	or NULL if out of memory.
+ */
+static MDB_uring *
+mdb_uring_open(void)
+{
+	MDB_uring *ur;
+	struct io_uring_params p;
+	void *m;
+
+	if (!(ur = calloc(1, sizeof(MDB_uring))))
+		return NULL;
+	memset(&p, 0, sizeof(p));
+	ur->mu_fd = syscall(__NR_io_uring_setup, MDB_URING_DEPTH, &p);
+	if (ur->mu_fd < 0) {
+		ur->mu_fd = -1;
+		return ur;
+	}
+	ur->mu_sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	ur->mu_cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	ur->mu_sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	m = mmap(NULL, ur->mu_sq_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+		ur->mu_fd, IORING_OFF_SQ_RING);
+	if (m == MAP_FAILED)
+		goto fail;
+	ur->mu_sq_ring = m;
+	m = mmap(NULL, ur->mu_cq_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+		ur->mu_fd, IORING_OFF_CQ_RING);
+	if (m == MAP_FAILED)
+		goto fail;
+	ur->mu_cq_ring = m;
+	m = mmap(NULL, ur->mu_sqes_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+		ur->mu_fd, IORING_OFF_SQES);
+	if (m == MAP_FAILED)
+		goto fail;
+	ur->mu_sqes = m;
+	ur->mu_sq_head = (unsigned *)((char *)ur->mu_sq_ring + p.sq_off.head);
+	ur->mu_sq_tail = (unsigned *)((char *)ur->mu_sq_ring + p.sq_off.tail);
+	ur->mu_sq_mask = (unsigned *)((char *)ur->mu_sq_ring + p.sq_off.ring_mask);
+	ur->mu_sq_array = (unsigned *)((char *)ur->mu_sq_ring + p.sq_off.array);
+	ur->mu_cq_head = (unsigned *)((char *)ur->mu_cq_ring + p.cq_off.head);
+	ur->mu_cq_tail = (unsigned *)((char *)ur->mu_cq_ring + p.cq_off.tail);
+	ur->mu_cq_mask = (unsigned *)((char *)ur->mu_cq_ring + p.cq_off.ring_mask);
+	ur->mu_cqes = (struct io_uring_cqe *)((char *)ur->mu_cq_ring + p.cq_off.cqes);
+	return ur;
+
+fail:
+	mdb_uring_close(ur);
+	if (!(ur = calloc(1, sizeof(MDB_uring))))
+		return NULL;
+	ur->mu_fd = -1;
+	return ur;
+}
+
+/** Add an entry to the submission queue. The caller guarantees there is room. */
+static void
+mdb_uring_prep(MDB_uring *ur, int op, HANDLE fd, struct iovec *iov, int n,
+	MDB_OFF_T pos, int flags, unsigned fsync_flags, __u64 data)
+{
+	unsigned tail = *ur->mu_sq_tail, idx = tail & *ur->mu_sq_mask;
+	struct io_uring_sqe *sqe = &ur->mu_sqes[idx];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = op;
+	sqe->flags = flags;
+	sqe->fd = fd;
+	sqe->off = pos;
+	sqe->addr = (__u64)(uintptr_t)iov;
+	sqe->len = n;
+	sqe->fsync_flags = fsync_flags;
+	sqe->user_data = data;
+	ur->mu_sq_array[idx] = idx;
+	__atomic_store_n(ur->mu_sq_tail, tail + 1, __ATOMIC_RELEASE);
+	ur->mu_queued++;
+}
+
+/** Synchronously write what is left of a run after a failed or short write. */
+static int
+mdb_uring_rewrite(HANDLE fd, MDB_uring_write *w, size_t done)
+{
+	MDB_OFF_T pos = w->mw_pos;
+	ssize_t wres;
+	int i, rc;
+
+	for (i = 0; i < w->mw_n; i++) {
+		char *base = w->mw_iov[i].iov_base;
+		size_t len = w->mw_iov[i].iov_len;
+		if (done >= len) {
+			done -= len;
+			pos += len;
+			continue;
+		}
+		base += done;
+		pos += done;
+		len -= done;
+		done = 0;
+		while (len) {
+			wres = pwrite(fd, base, len, pos);
+			if (wres < 0) {
+				rc = ErrCode();
+				if (rc == EINTR)
+					continue;
+				return rc;
+			}
+			if (wres == 0)
+				return EIO;
+			base += wres;
+			pos += wres;
+			len -= wres;
+		}
+	}
+	return MDB_SUCCESS;
+}
+
+/** Handle the completions that have been posted.
+ * Writes that failed or came up short are redone synchronously, in which
+ * case *rewritten is set, since a sync queued with them no longer covers them.
+ * The first failure is kept in *rc.
+ */
+static void
+mdb_uring_reap(MDB_uring *ur, HANDLE fd, int *rewritten, int *rc)
+{
+	unsigned head = *ur->mu_cq_head, tail;
+	int ret;
+
+	tail = __atomic_load_n(ur->mu_cq_tail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++) {
+		struct io_uring_cqe *cqe = &ur->mu_cqes[head & *ur->mu_cq_mask];
+		int res = cqe->res;
+		ur->mu_inflight--;
+		if (cqe->user_data == MDB_URING_SYNC) {
+			if (res < 0 && !*rc)
+				*rc = -res;
+		} else {
+			MDB_uring_write *w = &ur->mu_writes[cqe->user_data];
+			if (res != (ssize_t)w->mw_size) {
+				ret = mdb_uring_rewrite(fd, w, res < 0 ? 0 : res);
+				*rewritten = 1;
+				if (ret && !*rc) {
+					fprintf(stderr, "Write error: %s position %u, size %u", strerror(ret),
+						(unsigned)w->mw_pos, (unsigned)w->mw_size);
+					*rc = ret;
+				}
+			}
+		}
+	}
+	__atomic_store_n(ur->mu_cq_head, head, __ATOMIC_RELEASE);
+}
+
+/** Stop using the ring after io_uring_enter has failed. The kernel owns the
+ * pages (and iovecs) of the writes it has picked up until they complete, so
+ * those are waited for (from the completion ring directly, if the syscall
+ * keeps failing) before the ring is torn down. The writes it never picked
+ * up are then done with pwrite, as are all the writes after this.
+ */
+static void
+mdb_uring_abandon(MDB_uring *ur, HANDLE fd, int *rewritten, int *rc)
+{
+	unsigned head = __atomic_load_n(ur->mu_sq_head, __ATOMIC_ACQUIRE);
+	unsigned tail = *ur->mu_sq_tail;
+	int ret;
+
+	/* the kernel may have consumed some of the queue before failing */
+	ur->mu_inflight += ur->mu_queued - (tail - head);
+	ur->mu_queued = 0;
+	while (ur->mu_inflight) {
+		mdb_uring_reap(ur, fd, rewritten, rc);
+		if (ur->mu_inflight && syscall(__NR_io_uring_enter, ur->mu_fd, 0, 1,
+				IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+			struct timespec ts = { 0, 100000 };
+			nanosleep(&ts, NULL);
+		}
+	}
+	for (; head != tail; head++) {
+		__u64 data = ur->mu_sqes[ur->mu_sq_array[head & *ur->mu_sq_mask]].user_data;
+		if (data == MDB_URING_SYNC)
+			continue; /* the caller syncs, since the writes were redone */
+		ret = mdb_uring_rewrite(fd, &ur->mu_writes[data], 0);
+		*rewritten = 1;
+		if (ret && !*rc)
+			*rc = ret;
+	}
+	mdb_uring_teardown(ur);
+}
+
+/** Submit everything queued and wait for all of it to complete.
+ * @return 0 on success, non-zero on the first failure.
+ */
+static int
+mdb_uring_wait(MDB_uring *ur, HANDLE fd, int *rewritten)
+{
+	int rc = 0, ret;
+
+	while (ur->mu_queued || ur->mu_inflight) {
+		ret = syscall(__NR_io_uring_enter, ur->mu_fd, ur->mu_queued, 1,
+			IORING_ENTER_GETEVENTS, NULL, 0);
+		if (ret < 0) {
+			ret = ErrCode();
+			if (ret == EINTR || ret == EAGAIN || ret == EBUSY) {
+				/* make room in the completion ring before trying again */
+				mdb_uring_reap(ur, fd, rewritten, &rc);
+				continue;
+			}
+			mdb_uring_abandon(ur, fd, rewritten, &rc);
+			break;
+		}
+		ur->mu_queued -= ret;
+		ur->mu_inflight += ret;
+		mdb_uring_reap(ur, fd, rewritten, &rc);
+	}
+	ur->mu_used = 0;
+	return rc;
+}
+
+/** Queue a run of pages to be written */
+static int
+mdb_uring_write(MDB_uring *ur, HANDLE fd, struct iovec *iov, int n,
+	MDB_OFF_T pos, size_t size, int *rewritten)
+{
+	MDB_uring_write *w;
+	int rc;
+
+	if (ur->mu_fd < 0) {
+		/* the ring was abandoned after an error earlier in this flush */
+		w = &ur->mu_writes[0];
+		memcpy(w->mw_iov, iov, n * sizeof(struct iovec));
+		w->mw_pos = pos;
+		w->mw_size = size;
+		w->mw_n = n;
+		*rewritten = 1;
+		return mdb_uring_rewrite(fd, w, 0);
+	}
+	if (ur->mu_used == MDB_URING_DEPTH - 1) {
+		/* every slot is in flight, their iovecs can only be reused once written */
+		if ((rc = mdb_uring_wait(ur, fd, rewritten)))
+			return rc;
+	}
+	w = &ur->mu_writes[ur->mu_used];
+	memcpy(w->mw_iov, iov, n * sizeof(struct iovec));
+	w->mw_pos = pos;
+	w->mw_size = size;
+	w->mw_n = n;
+	mdb_uring_prep(ur, IORING_OP_WRITEV, fd, w->mw_iov, n, pos, 0, 0, ur->mu_used++);
+	return MDB_SUCCESS;
+}
+#endif
+/* </lmdb-js> */
+
 /** Flush (some) dirty pages to the map, after clearing their dirty flag.
  * @param[in] txn the transaction that's being committed
  * @param[in] keep number of initial pages in dirty_list to keep dirty.
@@ -4534,6 +5092,13 @@ mdb_page_flush(MDB_txn *txn, int keep)
 #else
 	struct iovec iov[MDB_COMMIT_PAGES];
 	HANDLE fd = env->me_fd;
+#endif
+#ifdef MDB_USE_IO_URING
+	MDB_uring	*uring = NULL;
+	int			rewritten = 0;
+#endif
+#ifdef MDB_USE_SYNC_RANGES
+	int			record = 0;
 #endif
 	ssize_t		wsize = 0, wres;
 	MDB_OFF_T	wpos = 0, next_pos = 1; /* impossible pos, so pos != next_pos */
@@ -4545,6 +5110,20 @@ mdb_page_flush(MDB_txn *txn, int keep)
 		goto done;
 	}
 	int pages_written = 0;
+#ifdef MDB_USE_IO_URING
+	if (!env->me_uring)
+		env->me_uring = mdb_uring_open();
+	if (env->me_uring && env->me_uring->mu_fd >= 0)
+		uring = env->me_uring;
+#endif
+#ifdef MDB_USE_SYNC_RANGES
+	/* overlapping sync txns are synced later, starting with the ranges they wrote */
+	if ((txn->mt_flags & MDB_NOSYNC) &&
+		(env->me_flags & (MDB_OVERLAPPINGSYNC|MDB_SYNC_RANGES)) == (MDB_OVERLAPPINGSYNC|MDB_SYNC_RANGES)) {
+		record = 1;
+		mdb_sync_range_begin(env, txn->mt_txnid);
+	}
+#endif
 	/* setup nump list, flag that it's in use */
 	dl_nump = env->me_dirty_nump;
 	/* <lmdb-js addition> */
@@ -4686,6 +5265,14 @@ retry_write:
 					rc = 0;
 				}
 #else /* _WIN32 */
+#ifdef MDB_USE_IO_URING
+				if (uring) {
+					if ((env->me_flags & MDB_TRACK_METRICS) && uring->mu_fd >= 0)
+						env->me_metrics.uring_writes++;
+					rc = mdb_uring_write(uring, fd, iov, n, wpos, wsize, &rewritten);
+					goto queued;
+				}
+#endif
 #ifdef MDB_USE_PWRITEV
 				wres = pwritev(fd, iov, n, wpos);
 #else
@@ -4718,6 +5305,13 @@ retry_seek:
 						DPUTS("short write, filesystem full?");
 					}
 				}
+#ifdef MDB_USE_IO_URING
+queued:
+#endif
+#ifdef MDB_USE_SYNC_RANGES
+				if (record && !rc)
+					mdb_sync_range_add(env, txn->mt_txnid, wpos, wsize);
+#endif
 #endif /* _WIN32 */
 				write_i++;
 				if (rc)
@@ -4735,11 +5329,18 @@ retry_seek:
 		}
 		if (env->me_encfunc) {
 			MDB_page *encp = mdb_page_malloc(txn, nump, 0);
-			if (!encp)
-				return ENOMEM;
-			if (mdb_page_encrypt(env, dp, encp, size)) {
+			rc = encp ? MDB_SUCCESS : ENOMEM;
+			if (encp && mdb_page_encrypt(env, dp, encp, size)) {
 				mdb_dpage_free_n(env, encp, nump);
-				return MDB_CRYPTO_FAIL;
+				rc = MDB_CRYPTO_FAIL;
+			}
+			if (rc) {
+#ifdef MDB_USE_IO_URING
+				/* the pages already queued must not be freed under the kernel */
+				if (uring)
+					mdb_uring_wait(uring, fd, &rewritten);
+#endif
+				return rc;
 			}
 			mdb_dpage_free_n(env, dp, nump);
 			dp = encp;
@@ -4767,6 +5368,32 @@ retry_seek:
 	 * flushed.
 	 */
 	CACHEFLUSH(env->me_map, txn->mt_next_pgno * env->me_psize, DCACHE);
+#ifdef MDB_USE_IO_URING
+	if (uring) {
+		/* The sync drains the queue, so it starts once every page write has
+		 * completed, and the commit doesn't need its own fdatasync.
+		 */
+		int syncing = (txn->mt_flags & MDB_TXN_FLUSH_SYNC) && uring->mu_fd >= 0;
+		uint64_t start = 0;
+		if (syncing) {
+			mdb_uring_prep(uring, IORING_OP_FSYNC, fd, NULL, 0, 0, IOSQE_IO_DRAIN,
+				(env->me_flags & MDB_FSYNCONLY) ? 0 : IORING_FSYNC_DATASYNC, MDB_URING_SYNC);
+			if (env->me_flags & MDB_TRACK_METRICS)
+				start = get_time64();
+		}
+		if ((rc = mdb_uring_wait(uring, fd, &rewritten)))
+			return rc;
+		if (syncing && !rewritten) {
+			txn->mt_flags |= MDB_TXN_SYNCED;
+			/* count it like mdb_env_sync0(), the wait is mostly for the sync,
+			 * which can't start until the writes are done */
+			if (env->me_flags & MDB_TRACK_METRICS) {
+				env->me_metrics.syncs++;
+				env->me_metrics.time_sync += get_time64() - start;
+			}
+		}
+	}
+#endif
 	if (env->me_flags & MDB_TRACK_METRICS) {
 		env->me_metrics.writes += write_i;
 		env->me_metrics.page_flushes++;
@@ -5039,6 +5666,14 @@ mdb_txn_commit(MDB_txn *txn)
 	mdb_audit(txn);
 #endif
 	int dirty_pages = txn->mt_u.dirty_list[0].mid;
+	if (!F_ISSET(txn->mt_flags, MDB_TXN_NOSYNC) && !(env->me_flags & MDB_NOSYNC)) {
+		txn->mt_flags |= MDB_TXN_FLUSH_SYNC;
+		if (env->me_flags & MDB_TRACK_METRICS)
+			env->me_metrics.synced_txns++;
+		/* this txn is synced now, so anything it references outside the data file has to be synced first */
+		if (env->me_sync_callback && (rc = env->me_sync_callback(env)))
+			goto fail;
+	}
 	if ((rc = mdb_page_flush(txn, 0)))
 		goto fail;
 	if ((unsigned)txn->mt_loose_count < txn->mt_u.dirty_list[0].mid) {
@@ -5047,9 +5682,16 @@ mdb_txn_commit(MDB_txn *txn)
 		rc = MDB_PROBLEM; /* mt_loose_pgs does not match dirty_list */
 		goto fail;
 	}
-	if (!F_ISSET(txn->mt_flags, MDB_TXN_NOSYNC) &&
-		(rc = mdb_env_sync0(env, 0, txn->mt_next_pgno)))
-		goto fail;
+	if (!F_ISSET(txn->mt_flags, MDB_TXN_NOSYNC) && !(txn->mt_flags & MDB_TXN_SYNCED)) {
+		uint64_t start = 0;
+		if (env->me_flags & MDB_TRACK_METRICS)
+			start = get_time64();
+		rc = mdb_env_sync0(env, 0, txn->mt_next_pgno);
+		if (env->me_flags & MDB_TRACK_METRICS)
+			env->me_metrics.time_sync += get_time64() - start;
+		if (rc)
+			goto fail;
+	}
 
 	//<lmdb-js>
 	if ((txn->mt_flags & MDB_NOSYNC) && (env->me_flags & MDB_OVERLAPPINGSYNC))
@@ -5126,7 +5768,7 @@ done:
 				sync_txn.mt_next_pgno = m->mm_last_pg + 1;
 			} while(ti->mti_txnid != txn_id); // avoid race condition in copying data by verifying that this is updated
 
-			rc = mdb_env_sync0(env, 0, m->mm_last_pg);
+			rc = mdb_env_sync_txns(env, 0, txn_id, m->mm_last_pg);
 			if (rc) {
 				UNLOCK_MUTEX(env->me_sync_mutex);
 				return rc;
@@ -5535,6 +6177,9 @@ mdb_env_create(MDB_env **env)
 #endif
 	e->me_pid = getpid();
 	GET_PAGESIZE(e->me_os_psize);
+#ifdef MDB_USE_SYNC_RANGES
+	pthread_mutex_init(&e->me_sr_mutex, NULL);
+#endif
 	VGMEMP_CREATE(e,0,0);
 	*env = e;
 	return MDB_SUCCESS;
@@ -6738,7 +7383,7 @@ mdb_env_envflags(MDB_env *env)
 	 */
 #define	CHANGEABLE	(MDB_NOSYNC|MDB_NOMETASYNC|MDB_MAPASYNC|MDB_NOMEMINIT)
 #define	CHANGELESS	(MDB_FIXEDMAP|MDB_NOSUBDIR|MDB_RDONLY| \
-	MDB_WRITEMAP|MDB_NOTLS|MDB_NOLOCK|MDB_NORDAHEAD|MDB_PREVSNAPSHOT|MDB_REMAP_CHUNKS|MDB_OVERLAPPINGSYNC|MDB_SAFE_RESTORE|MDB_TRACK_METRICS)
+	MDB_WRITEMAP|MDB_NOTLS|MDB_NOLOCK|MDB_NORDAHEAD|MDB_PREVSNAPSHOT|MDB_REMAP_CHUNKS|MDB_OVERLAPPINGSYNC|MDB_SAFE_RESTORE|MDB_TRACK_METRICS|MDB_SYNC_RANGES)
 #define EXPOSED		(CHANGEABLE|CHANGELESS | MDB_ENCRYPT)
 
 #if VALID_FLAGS & PERSISTENT_FLAGS & EXPOSED
@@ -7014,6 +7659,16 @@ mdb_env_close_active(MDB_env *env, int excl)
 	free(env->me_path);
 	free(env->me_dirty_list);
 	free(env->me_dirty_nump);
+#ifdef MDB_USE_IO_URING
+	mdb_uring_close(env->me_uring);
+	env->me_uring = NULL;
+#endif
+#ifdef MDB_USE_SYNC_RANGES
+	free(env->me_sr_list);
+	env->me_sr_list = NULL;
+	env->me_sr_count = env->me_sr_size = 0;
+	env->me_sr_last = env->me_sr_gap = 0;
+#endif
 #if MDB_RPAGE_CACHE
 	if (MDB_REMAPPING(env->me_flags)) {
 	if (env->me_txn0 && env->me_txn0->mt_rpages)
@@ -7181,6 +7836,9 @@ mdb_env_close(MDB_env *env)
 	mdb_env_close_active(env, 0);
 #if MDB_RPAGE_CACHE
 	free(env->me_enckey.mv_data);
+#endif
+#ifdef MDB_USE_SYNC_RANGES
+	pthread_mutex_destroy(&env->me_sr_mutex);
 #endif
 	free(env);
 }
@@ -9589,6 +10247,12 @@ current:
 new_sub:
 	nflags = flags & NODE_ADD_FLAGS;
 	nsize = IS_LEAF2(mc->mc_pg[mc->mc_top]) ? key->mv_size : mdb_leaf_size(env, key, rdata);
+	/* <lmdb-js> */
+	/* not for a new dup, which doesn't append (see below) */
+	if ((nflags & MDB_APPEND) && !(mc->mc_flags & C_SUB) &&
+		(flags & (F_DUPDATA|F_SUBDATA)) != F_DUPDATA && NUMKEYS(mc->mc_pg[mc->mc_top]))
+		nsize += mc->mc_txn->mt_fill_reserve; /* split at the fill factor */
+	/* </lmdb-js> */
 	if (SIZELEFT(mc->mc_pg[mc->mc_top]) < nsize) {
 		if (( flags & (F_DUPDATA|F_SUBDATA)) == F_DUPDATA )
 			nflags &= ~MDB_APPEND; /* sub-page may need room to grow */
@@ -10425,6 +11089,46 @@ mdb_cursor_dbi(MDB_cursor *mc)
 	return mc->mc_dbi;
 }
 
+/* <lmdb-js> */
+/** Advise the OS to read ahead the leaf pages that follow the cursor's current page (the next
+ * children of its parent branch page), so a range scan doesn't fault them in one at a time.
+ * This only applies when pages are read directly from the memory map.
+ * @return the number of pages advised */
+int
+mdb_cursor_readahead(MDB_cursor *mc, unsigned int max_pages)
+{
+	unsigned int count = 0;
+#if !defined(_WIN32) && defined(MADV_WILLNEED)
+	MDB_env *env;
+	MDB_page *parent;
+	unsigned int i, nkeys;
+	pgno_t pgno, run_start = 0, run_end = 0;
+	if (!mc || !(mc->mc_flags & C_INITIALIZED) || mc->mc_snum < 2)
+		return 0;
+	env = mc->mc_txn->mt_env;
+	if (MDB_REMAPPING(env->me_flags) || (env->me_flags & MDB_ENCRYPT))
+		return 0;
+	parent = mc->mc_pg[mc->mc_top - 1];
+	nkeys = NUMKEYS(parent);
+	for (i = mc->mc_ki[mc->mc_top - 1] + 1; i < nkeys && count < max_pages; i++, count++) {
+		pgno = NODEPGNO(NODEPTR(parent, i));
+		if (run_end && pgno == run_end) {
+			/* coalesce consecutive pages into one call */
+			run_end++;
+			continue;
+		}
+		if (run_end)
+			madvise(env->me_map + run_start * env->me_psize, (run_end - run_start) * env->me_psize, MADV_WILLNEED);
+		run_start = pgno;
+		run_end = pgno + 1;
+	}
+	if (run_end)
+		madvise(env->me_map + run_start * env->me_psize, (run_end - run_start) * env->me_psize, MADV_WILLNEED);
+#endif
+	return count;
+}
+/* </lmdb-js> */
+
 int
 mdb_cursor_is_db(MDB_cursor *mc)
 {
@@ -11509,7 +12213,10 @@ mdb_page_split(MDB_cursor *mc, MDB_val *newkey, MDB_val *newdata, pgno_t newpgno
 
 	/* Copy separator key to the parent.
 	 */
-	if (SIZELEFT(mn.mc_pg[ptop]) < mdb_branch_size(env, &sepkey)) {
+	/* <lmdb-js> */
+	if (SIZELEFT(mn.mc_pg[ptop]) < mdb_branch_size(env, &sepkey) +
+		((nflags & MDB_APPEND) && NUMKEYS(mn.mc_pg[ptop]) > 1 ? mc->mc_txn->mt_fill_reserve : 0)) {
+	/* </lmdb-js> */
 		int snum = mc->mc_snum;
 		mn.mc_snum--;
 		mn.mc_top--;
@@ -12381,6 +13088,15 @@ mdb_env_set_callback(MDB_env *env, MDB_check_fd *func)
 	return MDB_SUCCESS;
 }
 
+int ESECT
+mdb_env_set_sync_callback(MDB_env *env, MDB_sync_func *func)
+{
+	if (!env)
+		return EINVAL;
+	env->me_sync_callback = func;
+	return MDB_SUCCESS;
+}
+
 int ESECT
 mdb_env_set_freespace_options(MDB_env *env, unsigned int max_to_load, unsigned int max_to_retain)
 {
@@ -290,7 +290,7 @@ badend:
 
 static void usage(void)
 {
-	fprintf(stderr, "usage: %s [-V] [-a] [-f input] [-n] [-m module [-w password]] [-s name] [-N] [-T] dbpath\n", prog);
+	fprintf(stderr, "usage: %s [-V] [-a [-F fill]] [-f input] [-n] [-m module [-w password]] [-s name] [-N] [-T] dbpath\n", prog);
 	exit(EXIT_FAILURE);
 }
 
@@ -308,7 +308,7 @@ int main(int argc, char *argv[])
 	MDB_dbi dbi;
 	char *envname;
 	int envflags = MDB_NOSYNC, putflags = 0;
-	int dohdr = 0, append = 0;
+	int dohdr = 0, append = 0, fill = 0;
 	MDB_val prevk;
 	char *module = NULL, *password = NULL, *errmsg;
 	void *mlm = NULL;
@@ -320,6 +320,7 @@ int main(int argc, char *argv[])
 	}
 
 	/* -a: append records in input order
+	 * -F: with -a, percent to fill each page before starting a new one
 	 * -f: load file instead of stdin
 	 * -n: use NOSUBDIR flag on env_open
 	 * -s: load into named subDB
@@ -327,7 +328,7 @@ int main(int argc, char *argv[])
 	 * -T: read plaintext
 	 * -V: print version and exit
 	 */
-	while ((i = getopt(argc, argv, "af:m:ns:w:NTV")) != EOF) {
+	while ((i = getopt(argc, argv, "aF:f:m:ns:w:NTV")) != EOF) {
 		switch(i) {
 		case 'V':
 			printf("%s\n", MDB_VERSION_STRING);
@@ -336,6 +337,11 @@ int main(int argc, char *argv[])
 		case 'a':
 			append = 1;
 			break;
+		case 'F':
+			fill = atoi(optarg);
+			if (fill < 10 || fill > 100)
+				usage();
+			break;
 		case 'f':
 			if (freopen(optarg, "r", stdin) == NULL) {
 				fprintf(stderr, "%s: %s: reopen: %s\n",
@@ -366,7 +372,7 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	if (optind != argc - 1)
+	if (optind != argc - 1 || (fill && !append))
 		usage();
 
 	dbuf.mv_size = 4096;
@@ -436,6 +442,8 @@ int main(int argc, char *argv[])
 			fprintf(stderr, "mdb_dbi_open failed, error %d %s\n", rc, mdb_strerror(rc));
 			goto txn_abort;
 		}
+		if (fill)
+			mdb_txn_set_fill(txn, fill);
 		prevk.mv_size = 0;
 		if (append) {
 			mdb_set_compare(txn, dbi, greater);
@@ -497,6 +505,8 @@ int main(int argc, char *argv[])
 					fprintf(stderr, "mdb_txn_begin failed, error %d %s\n", rc, mdb_strerror(rc));
 					goto env_close;
 				}
+				if (fill)
+					mdb_txn_set_fill(txn, fill);
 				rc = mdb_cursor_open(txn, dbi, &mc);
 				if (rc) {
 					fprintf(stderr, "mdb_cursor_open failed, error %d %s\n", rc, mdb_strerror(rc));
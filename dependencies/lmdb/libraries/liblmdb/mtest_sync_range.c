@@ -0,0 +1,191 @@
+/* mtest_sync_range.c - overlapping syncs that write out the ranges of their txns first */
+/*
+ * Copyright 2011-2021 Howard Chu, Symas Corp.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the Symas
+ * Dual-Use License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * source distribution.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "lmdb.h"
+
+#define E(expr) CHECK((rc = (expr)) == MDB_SUCCESS, #expr)
+#define CHECK(test, msg) ((test) ? (void)0 : ((void)fprintf(stderr, \
+	"%s:%d: %s: %s\n", __FILE__, __LINE__, msg, mdb_strerror(rc)), abort()))
+
+#if defined(__linux__) && defined(SYNC_FILE_RANGE_WRITE)
+
+static MDB_env *env;
+static MDB_dbi dbi;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+	/* 1 to hold the next sync in the callback until it is released,
+	 * 2 while it is held, 3 to fail the next sync
+	 */
+static int hold_sync;
+
+static int sync_callback(MDB_env *env)
+{
+	int rc = 0;
+	pthread_mutex_lock(&mutex);
+	if (hold_sync == 1) {
+		hold_sync = 2;
+		pthread_cond_broadcast(&cond);
+		while (hold_sync == 2)
+			pthread_cond_wait(&cond, &mutex);
+	} else if (hold_sync == 3) {
+		hold_sync = 0;
+		rc = EIO;
+	}
+	pthread_mutex_unlock(&mutex);
+	return rc;
+}
+
+	/* commit a txn that is synced after it is visible, as lmdb-js does */
+static int put_values(int start, int count)
+{
+	int i, rc;
+	MDB_txn *txn;
+	MDB_val key, data;
+	char kval[32], dval[1000];
+
+	E(mdb_txn_begin(env, NULL, MDB_NOSYNC, &txn));
+	for (i = start; i < start + count; i++) {
+		sprintf(kval, "%08d", i);
+		memset(dval, 'a' + i % 26, sizeof(dval));
+		key.mv_size = strlen(kval);
+		key.mv_data = kval;
+		data.mv_size = sizeof(dval);
+		data.mv_data = dval;
+		E(mdb_put(txn, dbi, &key, &data, 0));
+	}
+	return mdb_txn_commit(txn);
+}
+
+static void *put_thread(void *arg)
+{
+	int rc;
+	E(put_values((int)(long)arg, 10));
+	return NULL;
+}
+
+	/* read the values back from a fresh env, so they come from the file */
+static void check_values(int count)
+{
+	int i, rc;
+	MDB_env *env;
+	MDB_txn *txn;
+	MDB_val key, data;
+	char kval[32];
+
+	E(mdb_env_create(&env));
+	E(mdb_env_set_mapsize(env, 10485760));
+	E(mdb_env_open(env, "./testdb", MDB_RDONLY, 0664));
+	E(mdb_txn_begin(env, NULL, MDB_RDONLY, &txn));
+	E(mdb_dbi_open(txn, NULL, 0, &dbi));
+	for (i = 0; i < count; i++) {
+		sprintf(kval, "%08d", i);
+		key.mv_size = strlen(kval);
+		key.mv_data = kval;
+		E(mdb_get(txn, dbi, &key, &data));
+		CHECK(data.mv_size == 1000 && ((char *)data.mv_data)[999] == 'a' + i % 26, "value");
+	}
+	mdb_txn_abort(txn);
+	mdb_env_close(env);
+}
+
+int main(int argc, char *argv[])
+{
+	int i, rc;
+	MDB_txn *txn;
+	MDB_metrics *metrics;
+	pthread_t first, second;
+
+	unlink("./testdb/data.mdb");
+	unlink("./testdb/lock.mdb");
+	E(mdb_env_create(&env));
+	E(mdb_env_set_mapsize(env, 10485760));
+	E(mdb_env_set_sync_callback(env, sync_callback));
+	E(mdb_env_open(env, "./testdb", MDB_OVERLAPPINGSYNC|MDB_SYNC_RANGES|MDB_TRACK_METRICS, 0664));
+	metrics = mdb_env_get_metrics(env);
+	E(mdb_txn_begin(env, NULL, MDB_NOSYNC, &txn));
+	E(mdb_dbi_open(txn, NULL, 0, &dbi));
+	mdb_txn_abort(txn);
+
+	/* each commit writes out the ranges it wrote, and then syncs the file */
+	for (i = 0; i < 10; i++)
+		E(put_values(i * 10, 10));
+	CHECK(metrics->range_syncs >= 10, "commits write out their ranges");
+	CHECK(metrics->syncs == metrics->range_syncs, "and still sync the file");
+
+	/* a commit while another is still syncing writes out its own ranges */
+	metrics->range_syncs = metrics->syncs = 0;
+	hold_sync = 1;
+	pthread_create(&first, NULL, put_thread, (void *)100L);
+	pthread_mutex_lock(&mutex);
+	while (hold_sync != 2)
+		pthread_cond_wait(&cond, &mutex);
+	pthread_mutex_unlock(&mutex);
+	pthread_create(&second, NULL, put_thread, (void *)110L);
+	usleep(100000);
+	pthread_mutex_lock(&mutex);
+	hold_sync = 0;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&mutex);
+	pthread_join(first, NULL);
+	pthread_join(second, NULL);
+	CHECK(metrics->range_syncs == 2, "overlapping commits write out their ranges");
+	CHECK(metrics->syncs == 2, "and still sync the file");
+
+	/* txns whose sync failed keep their ranges for mdb_env_sync */
+	hold_sync = 3;
+	rc = put_values(120, 10);
+	CHECK(rc == EIO, "the sync fails");
+	E(put_values(130, 10));
+	metrics->range_syncs = metrics->syncs = 0;
+	hold_sync = 3;
+	rc = put_values(140, 10);
+	CHECK(rc == EIO, "the sync fails");
+	E(mdb_env_sync(env, 1));
+	CHECK(metrics->range_syncs == 1, "mdb_env_sync writes out the ranges");
+	CHECK(metrics->syncs == 1, "and syncs the file");
+	E(mdb_env_sync(env, 1));
+	CHECK(metrics->range_syncs == 1, "and nothing is left to sync");
+	mdb_env_close(env);
+	check_values(150);
+
+	/* without MDB_SYNC_RANGES, overlapping syncs just sync the file */
+	E(mdb_env_create(&env));
+	E(mdb_env_set_mapsize(env, 10485760));
+	E(mdb_env_open(env, "./testdb", MDB_OVERLAPPINGSYNC|MDB_TRACK_METRICS, 0664));
+	metrics = mdb_env_get_metrics(env);
+	E(mdb_txn_begin(env, NULL, MDB_NOSYNC, &txn));
+	E(mdb_dbi_open(txn, NULL, 0, &dbi));
+	mdb_txn_abort(txn);
+	for (i = 15; i < 20; i++)
+		E(put_values(i * 10, 10));
+	CHECK(metrics->range_syncs == 0, "no ranges are written out");
+	CHECK(metrics->syncs >= 5, "the file is synced");
+	mdb_env_close(env);
+	check_values(200);
+	printf("overlapping syncs of the written ranges work\n");
+	return 0;
+}
+#else
+int main(int argc, char *argv[])
+{
+	printf("sync_file_range is not available, skipping\n");
+	return 0;
+}
+#endif
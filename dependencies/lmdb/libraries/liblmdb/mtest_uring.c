@@ -0,0 +1,168 @@
+/* mtest_uring.c - page writes through io_uring, and the fallback to pwrite */
+/*
+ * Copyright 2011-2021 Howard Chu, Symas Corp.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the Symas
+ * Dual-Use License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * source distribution.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "lmdb.h"
+
+#define E(expr) CHECK((rc = (expr)) == MDB_SUCCESS, #expr)
+#define CHECK(test, msg) ((test) ? (void)0 : ((void)fprintf(stderr, \
+	"%s:%d: %s: %s\n", __FILE__, __LINE__, msg, mdb_strerror(rc)), abort()))
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+
+	/* fail the next io_uring_enter: 1 before anything is submitted,
+	 * 2 after submitting the queue (so the writes are in flight)
+	 */
+static int fail_enter;
+
+	/* mdb.c drives the ring with syscall(), so this stands in for it */
+long syscall(long number, ...)
+{
+	static long (*real)(long, ...);
+	long a[6];
+	va_list ap;
+	int i;
+
+	if (!real)
+		real = (long (*)(long, ...))dlsym(RTLD_NEXT, "syscall");
+	va_start(ap, number);
+	for (i = 0; i < 6; i++)
+		a[i] = va_arg(ap, long);
+	va_end(ap);
+	if (number == __NR_io_uring_enter && fail_enter) {
+		if (fail_enter == 2)
+			real(number, a[0], a[1], 0L, 0L, NULL, 0L);
+		fail_enter = 0;
+		errno = EIO;
+		return -1;
+	}
+	return real(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+static void put_values(MDB_env *env, int start, int count)
+{
+	int i, rc;
+	MDB_dbi dbi;
+	MDB_txn *txn;
+	MDB_val key, data;
+	char kval[32], dval[1000];
+
+	E(mdb_txn_begin(env, NULL, 0, &txn));
+	E(mdb_dbi_open(txn, NULL, 0, &dbi));
+	for (i = start; i < start + count; i++) {
+		sprintf(kval, "%08d", i);
+		memset(dval, 'a' + i % 26, sizeof(dval));
+		key.mv_size = strlen(kval);
+		key.mv_data = kval;
+		data.mv_size = sizeof(dval);
+		data.mv_data = dval;
+		E(mdb_put(txn, dbi, &key, &data, 0));
+	}
+	E(mdb_txn_commit(txn));
+}
+
+	/* read the values back from a fresh env, so they come from the file */
+static void check_values(int count)
+{
+	int i, rc;
+	MDB_env *env;
+	MDB_dbi dbi;
+	MDB_txn *txn;
+	MDB_val key, data;
+	char kval[32];
+
+	E(mdb_env_create(&env));
+	E(mdb_env_set_mapsize(env, 10485760));
+	E(mdb_env_open(env, "./testdb", MDB_RDONLY, 0664));
+	E(mdb_txn_begin(env, NULL, MDB_RDONLY, &txn));
+	E(mdb_dbi_open(txn, NULL, 0, &dbi));
+	for (i = 0; i < count; i++) {
+		sprintf(kval, "%08d", i);
+		key.mv_size = strlen(kval);
+		key.mv_data = kval;
+		E(mdb_get(txn, dbi, &key, &data));
+		CHECK(data.mv_size == 1000 && ((char *)data.mv_data)[999] == 'a' + i % 26, "value");
+	}
+	mdb_txn_abort(txn);
+	mdb_env_close(env);
+}
+
+static MDB_env *open_env(void)
+{
+	int rc;
+	MDB_env *env;
+
+	E(mdb_env_create(&env));
+	E(mdb_env_set_mapsize(env, 10485760));
+	E(mdb_env_open(env, "./testdb", MDB_TRACK_METRICS, 0664));
+	return env;
+}
+
+int main(int argc, char *argv[])
+{
+	int rc = 0, failure;
+	char params[120]; /* struct io_uring_params */
+	MDB_env *env;
+	MDB_metrics *metrics;
+	mdb_size_t uring_writes;
+
+	memset(params, 0, sizeof(params));
+	rc = syscall(__NR_io_uring_setup, 1, params);
+	if (rc < 0) {
+		printf("io_uring is not available, skipping\n");
+		return 0;
+	}
+	close(rc);
+	unlink("./testdb/data.mdb");
+	unlink("./testdb/lock.mdb");
+
+	env = open_env();
+	metrics = mdb_env_get_metrics(env);
+	put_values(env, 0, 100);
+	CHECK(metrics->uring_writes > 0, "the pages are written through io_uring");
+	CHECK(metrics->syncs > 0 && metrics->time_sync > 0, "the io_uring sync is counted");
+	mdb_env_close(env);
+	check_values(100);
+
+	for (failure = 1; failure <= 2; failure++) {
+		env = open_env();
+		metrics = mdb_env_get_metrics(env);
+		put_values(env, failure * 100, 10);
+		/* the commit still succeeds, with the pages written by pwrite */
+		fail_enter = failure;
+		put_values(env, failure * 100 + 10, 90);
+		CHECK(!fail_enter, "io_uring_enter was called");
+		uring_writes = metrics->uring_writes;
+		/* and the ring isn't used again */
+		put_values(env, failure * 100 + 100, 100);
+		CHECK(metrics->uring_writes == uring_writes, "falls back to pwrite");
+		mdb_env_close(env);
+		check_values(failure * 100 + 200);
+	}
+	printf("io_uring writes and the pwrite fallback work\n");
+	return 0;
+}
+#else
+int main(int argc, char *argv[])
+{
+	printf("io_uring is not available, skipping\n");
+	return 0;
+}
+#endif
@@ -19,6 +19,15 @@ declare namespace lmdb {
 			value: V
 			version?: number
 		} | undefined
+		/**
+		* Get the entry as it was as of the given version, from the database or its history (requires the history option)
+		* @param id The key for the entry
+		* @param version The version to look up, the latest version at or before it is returned
+		**/
+		getAsOf(id: K, version: number, options?: GetOptions): {
+			value: V
+			version: number
+		} | undefined
 
 		/**
 		* Get the value stored by given id/key in binary format, as a Buffer
@@ -50,6 +59,14 @@ declare namespace lmdb {
 		* @param ids The keys for the entries to prefetch
 		**/
 		prefetch(ids: K[], callback?: Function): Promise<void>
+		/**
+		* Asynchronously walk the entries from start up to (not including) end in a separate thread, reading ahead
+		* the leaf pages and values, so that a following synchronous getRange will most likely be in memory.
+		* @param start The first key of the range (the beginning of the database if undefined)
+		* @param end The end of the range, not included (the end of the database if undefined)
+		* @param maxBytes Stop after this many bytes of keys and values have been visited
+		**/
+		prefetchRange(start?: K, end?: K, maxBytes?: number, callback?: Function): Promise<void>
 
 		/**
 		* Asynchronously get the values stored by the given ids and return the
@@ -132,6 +149,13 @@ declare namespace lmdb {
 		**/
 		removeSync(id: K, valueToRemove: V): boolean
 		/**
+		* Synchronously load entries that are in sorted key order, appending them in a single transaction
+		* @param entries The entries to load, in sorted order, after any existing keys
+		* @param options The fill factor (percentage) of the pages that are written
+		* @returns The number of entries loaded
+		**/
+		bulkLoad(entries: Iterable<{ key: K, value: V, version?: number }>, options?: { fillFactor?: number }): number
+		/**
 		* Get all the values for the given key (for dupsort databases)
 		* existing version
 		* @param key The key for the entry to remove
@@ -145,6 +169,13 @@ declare namespace lmdb {
 		**/
 		getValuesCount(key: K, options?: RangeOptions): number
 		/**
+		* Get all the values for the given key (for dupFixed databases) in a single bulk read, as packed fixed-size binary values
+		* @param key The key for the values to retrieve
+		* @param options The typed array type to use for the returned view of the values
+		**/
+		getValuesFixed(key: K, options?: { arrayType?: TypedArrayConstructor, transaction?: Transaction }): Buffer
+		getValuesFixed<T extends TypedArrayConstructor>(key: K, options: { arrayType: T, transaction?: Transaction }): InstanceType<T>
+		/**
 		* Get all the unique keys for the given range
 		* existing version
 		* @param options The options for the range/iterator
@@ -201,6 +232,15 @@ declare namespace lmdb {
 		 * used for that).
 		 */
 		getWriteTxnId(): number
+		/**
+		 * Returns the state of the asynchronous write queue, as tracked by the writer: the number of queued instructions,
+		 * the bytes of their values, and the estimated time (in milliseconds) to write and commit them (once measured).
+		 */
+		getWriteQueueStats(): { queueDepth: number, bytesPending: number, estimatedDrainTime?: number }
+		/**
+		 * Returns a promise that resolves when the write queue is within its limits (immediately if it already is).
+		 */
+		backpressure(): Promise<boolean>
 		/**
 		* Returns the current transaction and marks it as in use. This can then be explicitly used for read operations
 		* @returns The transaction object
@@ -209,8 +249,9 @@ declare namespace lmdb {
 		/**
 		* Execute a set of write operations that will all be batched together in next queued asynchronous transaction.
 		* @param action The function to execute with a set of write operations.
+		* @param options The durability level of the batch's writes
 		**/
-		batch<T>(action: () => any): Promise<boolean>
+		batch<T>(action: () => any, options?: { durability?: Durability }): Promise<boolean>
 		/**
 		* Execute writes actions that are all conditionally dependent on the entry with the provided key having the provided
 		* version number (checked atomically).
@@ -257,6 +298,14 @@ declare namespace lmdb {
 		**/
 		dropSync(): void
 		/**
+		* Compact the value log of this database, relocating live values and reclaiming the space of overwritten and removed values.
+		**/
+		compactValueLog(options?: { maxBytesPerTransaction?: number }): Promise<void>
+		/**
+		* Delete (up to maxEntries of) the expired entries of a database with a ttl, resolving to the number deleted.
+		**/
+		sweepExpired(maxEntries?: number): Promise<number>
+		/**
 		* @deprecated since version 2.0, use clearAsync() or clearSync() instead
 		*/
 		clear(): Promise<void>
@@ -324,6 +373,8 @@ declare namespace lmdb {
 	}
 
 	type Key = Key[] | string | symbol | number | boolean | Uint8Array;
+	type TypedArrayConstructor = Uint8ArrayConstructor | Uint16ArrayConstructor | Uint32ArrayConstructor | Int32ArrayConstructor |
+		Float32ArrayConstructor | Float64ArrayConstructor | BigUint64ArrayConstructor | BigInt64ArrayConstructor
 
 	interface DatabaseOptions {
 		name?: string
@@ -334,6 +385,28 @@ declare namespace lmdb {
 		useVersions?: boolean
 		keyEncoding?: 'uint32' | 'binary' | 'ordered-binary'
 		dupSort?: boolean
+		/** Used with dupSort to indicate that all the values for a key are the same size, which allows bulk retrieval with getValuesFixed */
+		dupFixed?: boolean
+		/** Store values at or above the threshold in a separate value log file, with only a reference in the database */
+		valueLog?: boolean | { threshold?: number, mapSize?: number }
+		/** Store identical large values once, referenced by content hash */
+		dedup?: boolean | { threshold?: number }
+		/** Maintain a Bloom filter of the keys, so lookups of missing keys can skip the database */
+		bloomFilter?: boolean | { bitsPerKey?: number, expectedKeys?: number }
+		/** Secondary indexes of a fixed byte range of the values, maintained natively in the same transactions as the writes */
+		indexes?: { name: string, offset?: number, length: number }[]
+		/** Keep superseded versions in a history database, for getAsOf (requires useVersions) */
+		history?: boolean | { maxVersions?: number, maxAge?: number }
+		/** Entries expire this many milliseconds after they are written, and are then treated as missing */
+		ttl?: number
+		/** How often (in milliseconds) expired entries are swept, or false to only sweep with sweepExpired */
+		sweepInterval?: number | false
+		/** Number of leaf pages to read ahead of forward cursor scans (true for 32) */
+		scanReadAhead?: boolean | number
+		/** The default durability level of asynchronous writes */
+		durability?: Durability
+		/** Queue the asynchronous writes as low priority, behind the other writes */
+		priority?: 'low' | 'normal'
 		strictAsyncOrder?: boolean
 	}
 	interface RootDatabaseOptions extends DatabaseOptions {
@@ -341,6 +414,10 @@ declare namespace lmdb {
 		maxDbs?: number
 		/** Set a longer delay (in milliseconds) to wait longer before committing writes to increase the number of writes per transaction (higher latency, but more efficient) **/
 		commitDelay?: number
+		/** The estimated time (in milliseconds) to drain the write queue, beyond which writes are slowed down (defaults to 2000) */
+		maxQueueDrainTime?: number
+		/** The bytes of queued values beyond which writes are slowed down (defaults to 256MB) */
+		maxQueueBytes?: number
 		/**
 		 * This can be used to specify the initial amount of how much virtual memory address space (in bytes) to allocate for mapping to the database files.
 		 * Setting a map size will typically disable remapChunks by default unless the size is larger than appropriate for the OS. Different OSes have different allocation limits.
@@ -353,6 +430,8 @@ declare namespace lmdb {
 		pageSize?: number
 		/** This enables committing transactions where LMDB waits for a transaction to be fully flushed to disk after the transaction has been committed and defaults to being enabled on non-Windows OSes. This option is discussed in more detail below. */
 		overlappingSync?: boolean
+		/** With overlappingSync on Linux, write out the file ranges of the transactions being flushed (with sync_file_range) before syncing the file. */
+		syncRanges?: boolean
 		/** Resolve asynchronous operations when commits are finished and visible and include a separate promise for when a commit is flushed to disk, as a flushed property on the commit promise. Note that you can alternately use the flushed property on the database. */
 		separateFlushed?: boolean
 		/**
@@ -377,6 +456,10 @@ declare namespace lmdb {
 		readOnly?: boolean
 		/** The maximum number of concurrent read transactions (readers) to be able to open ([more information](http://www.lmdb.tech/doc/group__mdb.html#gae687966c24b790630be2a41573fe40e2)). */
 		maxReaders?: number
+		/** The number of reset read transactions kept for reuse by the native background readers (like prefetch), defaults to 8. */
+		readTxnPoolSize?: number
+		/** The number of bytes of decompressed values to cache natively (shared by all threads), disabled by default. */
+		decompressedCacheSize?: number
 		/** This enables encryption, and the provided value is the key that is used for encryption. This may be a buffer or string, but must be 32 bytes/characters long. This uses the Chacha8 cipher for fast and secure on-disk encryption of data. */
 		encryptionKey?: string | Buffer
 		/**
@@ -400,6 +483,8 @@ declare namespace lmdb {
 	}
 	interface GetOptions {
 		transaction?: Transaction
+		/** Return binary data by reference to the memory map (only valid while the transaction is open), rather than copying it */
+		zeroCopy?: boolean
 	}
 	interface RangeOptions {
 		/** Starting key for a range **/
@@ -430,7 +515,12 @@ declare namespace lmdb {
 		noDupData?: boolean
 		/* The version of the entry to set */
 		version?: number
+		/* Whether the write's transaction is fsynced before the returned promise resolves */
+		durability?: Durability
+		/* Queue the write as low priority, so the other writes can be committed ahead of it */
+		priority?: 'low' | 'normal'
 	}
+	type Durability = 'sync' | 'flush' | 'none'
 	export enum TransactionFlags {
 		/* Indicates that the transaction needs to be abortable */
 		ABORTABLE = 1,
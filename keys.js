@@ -1,4 +1,4 @@
-import { getAddress, orderedBinary } from './native.js';
+import { getAddress, orderedBinary, encodeKey, encodeNumberKey, decodeKey } from './native.js';
 
 const REUSE_BUFFER_MODE = 512;
 const writeUint32Key = (key, target, start) => {
@@ -55,11 +55,77 @@ export function applyKeyHandling(store) {
 		store.writeKey = store.keyEncoder.writeKey;
 		store.readKey = store.keyEncoder.readKey;
 	} else {
-		store.writeKey = orderedBinary.writeKey;
-		store.readKey = orderedBinary.readKey;
+		if (nativeKeyShapes === undefined)
+			nativeKeyShapes = checkNativeKeyShapes();
+		store.writeKey = nativeKeyShapes ? writeKeyNative : orderedBinary.writeKey;
+		store.readKey = nativeKeyShapes ? readKeyNative : orderedBinary.readKey;
 	}
 }
 
+// The native ordered-binary codec handles the common key shapes (strings, non-negative numbers, and arrays of these)
+// directly in the target buffer, and anything else falls back to the JS encoder. Each shape is only enabled if
+// it produces the same bytes as the JS encoder (which defines the format).
+const KEY_STRINGS = 1;
+const KEY_NUMBERS = 2;
+const KEY_ARRAYS = 4;
+let nativeKeyShapes;
+function writeKeyNative(key, target, start) {
+	let address = target.buffer.address;
+	if (address) {
+		let length = typeof key === 'number' ?
+			(nativeKeyShapes & KEY_NUMBERS ? encodeNumberKey(key, address + target.byteOffset + start, target.byteLength - start) : -1) :
+			encodeKey(key, address + target.byteOffset + start, target.byteLength - start, nativeKeyShapes);
+		if (length > 0)
+			return start + length;
+	}
+	return orderedBinary.writeKey(key, target, start);
+}
+function readKeyNative(source, start, end) {
+	let address = source.buffer.address;
+	if (address) {
+		let key = decodeKey(address + source.byteOffset + start, end - start, nativeKeyShapes);
+		if (key !== undefined)
+			return key;
+	}
+	return orderedBinary.readKey(source, start, end);
+}
+function checkNativeKeyShapes() {
+	if (!encodeKey || !decodeKey || !getAddress)
+		return 0;
+	let now = Date.now();
+	let samples = [
+		[KEY_STRINGS, ['a', 'key1', 'some-longer-key-with-more-characters-in-it-than-the-short-string-path', 'ünïcödé', '日本語', 'emoji 😀']],
+		[KEY_NUMBERS, [0, 1, 2, 3.5, 0.1, 1e-10, 256, 12345678, now, Number.MAX_SAFE_INTEGER, 1.7e300]],
+		[KEY_ARRAYS, [['a', 1], [1, 'b'], ['x', 'y', 'z'], [1, 2, 3], [now, 'id', 0.5]]],
+	];
+	let jsBytes = typeof Buffer != 'undefined' ? Buffer.alloc(0x200) : new Uint8Array(0x200);
+	let nativeBytes = typeof Buffer != 'undefined' ? Buffer.alloc(0x200) : new Uint8Array(0x200);
+	let address = getAddress(nativeBytes.buffer) + nativeBytes.byteOffset;
+	let shapes = 0;
+	for (let [shape, keys] of samples) {
+		let matches = keys.every((key) => {
+			try {
+				let length = orderedBinary.writeKey(key, jsBytes, 0);
+				let nativeLength = typeof key === 'number' ?
+					encodeNumberKey(key, address, 0x200) :
+					encodeKey(key, address, 0x200, shape | KEY_STRINGS | KEY_NUMBERS);
+				if (length !== nativeLength) return false;
+				for (let i = 0; i < length; i++) {
+					if (jsBytes[i] !== nativeBytes[i]) return false;
+				}
+				let decoded = decodeKey(address, length, shape | KEY_STRINGS | KEY_NUMBERS);
+				return orderedBinary.compareKeys(decoded, key) === 0 && Array.isArray(decoded) === Array.isArray(key);
+			} catch (error) {
+				return false;
+			}
+		});
+		if (matches) shapes |= shape;
+	}
+	if ((shapes & (KEY_STRINGS | KEY_NUMBERS)) != (KEY_STRINGS | KEY_NUMBERS))
+		shapes &= ~KEY_ARRAYS; // arrays depend on both
+	return shapes;
+}
+
 let saveBuffer, uint32, saveDataView = { setFloat64() {}, setUint32() {} }, saveDataAddress;
 let savePosition = 8000;
 let DYNAMIC_KEY_BUFFER_SIZE = 8192;
@@ -26,6 +26,7 @@ export let Env,
 	setEnvMap,
 	getEnvMap,
 	getByBinary,
+	getAsOfByBinary,
 	detachBuffer,
 	startRead,
 	setReadCallback,
@@ -33,18 +34,25 @@ export let Env,
 	position,
 	iterate,
 	prefetch,
+	prefetchRange,
 	resetTxn,
 	getCurrentValue,
 	getCurrentShared,
 	getStringByBinary,
 	getSharedByBinary,
+	getValuesFixed,
 	getSharedBuffer,
 	compress,
 	directWrite,
 	getUserSharedBuffer,
 	notifyUserCallbacks,
+	getCommitFeed,
+	getWriteQueueStats,
 	attemptLock,
 	unlock,
+	encodeKey,
+	encodeNumberKey,
+	decodeKey,
 	version;
 path = pathModule;
 let dirName = dirname(fileURLToPath(import.meta.url)).replace(/dist$/, '');
@@ -95,6 +103,7 @@ export function setNativeFunctions(externals) {
 	createBufferForAddress = externals.createBufferForAddress;
 	clearKeptObjects = externals.clearKeptObjects || function () {};
 	getByBinary = externals.getByBinary;
+	getAsOfByBinary = externals.getAsOfByBinary;
 	detachBuffer = externals.detachBuffer;
 	startRead = externals.startRead;
 	setReadCallback = externals.setReadCallback;
@@ -102,18 +111,25 @@ export function setNativeFunctions(externals) {
 	globalBuffer = externals.globalBuffer;
 	getSharedBuffer = externals.getSharedBuffer;
 	prefetch = externals.prefetch;
+	prefetchRange = externals.prefetchRange;
 	iterate = externals.iterate;
 	position = externals.position;
 	resetTxn = externals.resetTxn;
 	directWrite = externals.directWrite;
 	getUserSharedBuffer = externals.getUserSharedBuffer;
 	notifyUserCallbacks = externals.notifyUserCallbacks;
+	getCommitFeed = externals.getCommitFeed;
+	getWriteQueueStats = externals.getWriteQueueStats;
 	attemptLock = externals.attemptLock;
 	unlock = externals.unlock;
+	encodeKey = externals.encodeKey;
+	encodeNumberKey = externals.encodeNumberKey;
+	decodeKey = externals.decodeKey;
 	getCurrentValue = externals.getCurrentValue;
 	getCurrentShared = externals.getCurrentShared;
 	getStringByBinary = externals.getStringByBinary;
 	getSharedByBinary = externals.getSharedByBinary;
+	getValuesFixed = externals.getValuesFixed;
 	write = externals.write;
 	compress = externals.compress;
 	Cursor = externals.Cursor;
@@ -2,7 +2,7 @@ import { Compression, getAddress, arch, fs, path as pathModule, lmdbError, Event
 	Dbi, tmpdir, os, nativeAddon, version } from './native.js';
 import { CachingStore, setGetLastVersion } from './caching.js';
 import { addReadMethods, makeReusableBuffer } from './read.js';
-import { addWriteMethods } from './write.js';
+import { addWriteMethods, durabilityFlags } from './write.js';
 import { applyKeyHandling } from './keys.js';
 let moduleRequire = typeof require == 'function' && require;
 export function setRequire(require) {
@@ -25,6 +25,14 @@ const MAX_KEY_SIZE = 4026;
 // 4KB (but is 16KB on M-series MacOS), and this keeps a consistent max key size when no page size specified.
 const DEFAULT_MAX_KEY_SIZE = 1978;
 const DEFAULT_COMMIT_DELAY = 0;
+const DEFAULT_VALUE_LOG_THRESHOLD = 0x4000;
+const DEFAULT_VALUE_LOG_COMPACTION_SIZE = 0x4000000;
+const DEFAULT_DEDUP_THRESHOLD = 0x1000;
+const DEFAULT_BLOOM_BITS_PER_KEY = 10;
+const DEFAULT_BLOOM_EXPECTED_KEYS = 0x100000;
+const DEFAULT_SCAN_READ_AHEAD = 32; // leaf pages
+const DEFAULT_SWEEP_INTERVAL = 1000;
+const DEFAULT_SWEEP_BATCH_SIZE = 100;
 
 export const allDbs = new Map();
 let defaultCompression;
@@ -134,6 +142,7 @@ export function open(path, options) {
 		(options.usePreviousSnapshot ? 0x2000000 : 0) |
 		(options.remapChunks ? 0x4000000 : 0) |
 		(options.safeRestore ? 0x800 : 0) |
+		(options.syncRanges ? 0x200 : 0) |
 		(options.trackMetrics ? 0x400 : 0);
 
 	let env = new Env();
@@ -183,6 +192,62 @@ export function open(path, options) {
 			if (dbOptions.dupSort && (dbOptions.useVersions || dbOptions.cache)) {
 				throw new Error('The dupSort flag can not be combined with versions or caching');
 			}
+			let extensions = {};
+			let valueLog = dbOptions.valueLog;
+			if (valueLog) {
+				if (dbOptions.dupSort)
+					throw new Error('The dupSort flag can not be combined with a value log');
+				if (options.encryptionKey)
+					throw new Error('A value log can not be used with encryption');
+				valueLog = Object.assign({ threshold: DEFAULT_VALUE_LOG_THRESHOLD }, typeof valueLog == 'object' ? valueLog : {});
+				extensions.valueLogThreshold = valueLog.threshold;
+				extensions.valueLogMapSize = valueLog.mapSize;
+			}
+			let dedup = dbOptions.dedup;
+			if (dedup) {
+				if (dbOptions.dupSort)
+					throw new Error('The dupSort flag can not be combined with deduplication');
+				extensions.dedupThreshold = (typeof dedup == 'object' && dedup.threshold) || DEFAULT_DEDUP_THRESHOLD;
+			}
+			let bloomFilter = dbOptions.bloomFilter;
+			if (bloomFilter) {
+				if (dbOptions.dupSort)
+					throw new Error('The dupSort flag can not be combined with a Bloom filter');
+				extensions.bloomBitsPerKey = bloomFilter.bitsPerKey || DEFAULT_BLOOM_BITS_PER_KEY;
+				extensions.bloomExpectedKeys = bloomFilter.expectedKeys || DEFAULT_BLOOM_EXPECTED_KEYS;
+			}
+			let indexes = dbOptions.indexes;
+			if (indexes) {
+				if (dbOptions.dupSort)
+					throw new Error('The dupSort flag can not be combined with indexes');
+				extensions.indexes = indexes.map(({ name, offset, length }) => {
+					if (typeof name != 'string' || !(length > 0))
+						throw new Error('An index must have a name and a length');
+					offset = offset || 0;
+					// compressed bytes can't be indexed, only the uncompressed start of the value
+					if (dbOptions.compression && offset + length > (dbOptions.compression.startingOffset || 0))
+						throw new Error('An index must be within the uncompressed starting bytes of compressed values');
+					return { name, offset, length };
+				});
+			}
+			let history = dbOptions.history;
+			if (history) {
+				if (!dbOptions.useVersions)
+					throw new Error('The history option requires useVersions');
+				extensions.history = {
+					maxVersions: history.maxVersions || 0,
+					maxAge: history.maxAge || 0,
+				};
+			}
+			if (dbOptions.ttl) {
+				if (dbOptions.dupSort)
+					throw new Error('The dupSort flag can not be combined with a ttl');
+				if (dbOptions.cache)
+					throw new Error('Caching can not be combined with a ttl, cached entries would not expire');
+				extensions.ttl = dbOptions.ttl;
+			}
+			if (dbOptions.scanReadAhead)
+				extensions.scanReadAhead = dbOptions.scanReadAhead === true ? DEFAULT_SCAN_READ_AHEAD : dbOptions.scanReadAhead;
 			let keyIsBuffer = dbOptions.keyIsBuffer
 			if (dbOptions.keyEncoding == 'uint32') {
 				dbOptions.keyIsUint32 = true;
@@ -213,10 +278,10 @@ export function open(path, options) {
 				// make sure we are using a fresh read txn, so we don't want to share with a cursor txn
 				this.resetReadTxn();
 				this.ensureReadTxn();
-				this.db = new Dbi(env, flags, dbName, keyType, dbOptions.compression);
+				this.db = new Dbi(env, flags, dbName, keyType, dbOptions.compression, extensions);
 			} else {
 				this.transactionSync(() => {
-					this.db = new Dbi(env, flags, dbName, keyType, dbOptions.compression);
+					this.db = new Dbi(env, flags, dbName, keyType, dbOptions.compression, extensions);
 				}, options.overlappingSync ? 0x10002 : 2); // no flush-sync, but synchronously commit
 			}
 			this._commitReadTxn(); // current read transaction becomes invalid after opening another db
@@ -237,11 +302,16 @@ export function open(path, options) {
 			if (dbOptions.immediateBatchThreshold)
 				console.warn('immediateBatchThreshold is no longer supported');
 			this.commitDelay = DEFAULT_COMMIT_DELAY;
+			if (dbOptions.ttl && !options.readOnly && dbOptions.sweepInterval !== false && dbOptions.sweepInterval !== 0)
+				this._scheduleSweep(dbOptions.sweepInterval || DEFAULT_SWEEP_INTERVAL);
 			Object.assign(this, { // these are the options that are inherited
 				path: options.path,
 				encoding: options.encoding,
 				strictAsyncOrder: options.strictAsyncOrder,
+				durability: options.durability,
 			}, dbOptions);
+			if (this.durability)
+				this.durabilityFlags = durabilityFlags(this.durability);
 			let Encoder;
 			if (this.encoder && this.encoder.Encoder) {
 				Encoder = this.encoder.Encoder;
@@ -346,6 +416,51 @@ export function open(path, options) {
 					justFreePages: true
 				}), options.overlappingSync ? 0x10002 : 2);
 		}
+		async compactValueLog(compactionOptions) {
+			let maxBytes = compactionOptions?.maxBytesPerTransaction || DEFAULT_VALUE_LOG_COMPACTION_SIZE;
+			let until = 0, result, lastPosition;
+			do {
+				lastPosition = result?.position;
+				// each step relocates the live values in a range and reclaims the range from the previous step
+				result = this.transactionSync(() => this.db.compactValueLog(maxBytes, until),
+					options.overlappingSync ? 0x10002 : 2);
+				until = until || result.end; // don't compact the values that were relocated by this compaction
+				await new Promise((resolve) => setImmediate(resolve));
+			} while (result.position !== lastPosition);
+		}
+		sweepExpired(maxEntries) {
+			// a small transaction in the write queue, like any other write
+			return this.transaction(() => this.db.sweepExpired(maxEntries || DEFAULT_SWEEP_BATCH_SIZE));
+		}
+		_scheduleSweep(interval) {
+			// one sweeper for each dbi in the env, however many stores are opened for it
+			let sweepers = env.sweepers || (env.sweepers = new Map());
+			let dbi = this.db.dbi;
+			let sweeper = sweepers.get(dbi);
+			if (sweeper) {
+				if (interval < sweeper.interval) sweeper.interval = interval;
+				return;
+			}
+			sweepers.set(dbi, (sweeper = { interval }));
+			let sweep = (delay) => {
+				let timer = setTimeout(async () => {
+					if (this.status != 'open' || !env.address)
+						return sweepers.delete(dbi); // closed
+					let swept = 0;
+					try {
+						swept = await this.sweepExpired(DEFAULT_SWEEP_BATCH_SIZE);
+					} catch (error) {
+						if (this.status != 'open' || !env.address)
+							return sweepers.delete(dbi);
+						console.warn('Error sweeping expired entries', error);
+					}
+					// keep going without waiting if there are more expired entries
+					sweep(swept >= DEFAULT_SWEEP_BATCH_SIZE ? 0 : sweeper.interval);
+				}, delay);
+				if (timer.unref) timer.unref(); // the sweeper doesn't keep the process alive
+			};
+			sweep(interval);
+		}
 		readerCheck() {
 			return env.readerCheck();
 		}
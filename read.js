@@ -6,14 +6,17 @@ import {
 	orderedBinary,
 	lmdbError,
 	getByBinary,
+	getAsOfByBinary,
 	setGlobalBuffer,
 	prefetch,
+	prefetchRange,
 	iterate,
 	position as doPosition,
 	resetTxn,
 	getCurrentValue,
 	getCurrentShared,
 	getStringByBinary,
+	getValuesFixed,
 	globalBuffer,
 	getSharedBuffer,
 	startRead,
@@ -41,6 +44,8 @@ if (!getValueBytes.maxLength) {
 }
 const START_ADDRESS_POSITION = 4064;
 const NEW_BUFFER_THRESHOLD = 0x8000;
+const ZERO_COPY_READ = 0x80000000; // key size flag to return values in place from the memory map
+const READ_RESULT_RELEASED = 0xffffffff; // tells the native read that the result was copied out
 const SOURCE_SYMBOL = Symbol.for('source');
 export const UNMODIFIED = {};
 let mmaps = [];
@@ -84,12 +89,25 @@ export function addReadMethods(
 				env.writeTxn ||
 				(options && options.transaction) ||
 				(readTxnRenewed ? readTxn : renewReadTxn(this));
-			rc = this.lastSize = getByBinary(
-				this.dbAddress,
-				this.writeKey(id, keyBytes, 0),
-				(options && options.ifNotTxnId) || 0,
-				txn.address || 0,
-			);
+			// with an explicit read txn, the snapshot is pinned, and values can be referenced in place
+			let zeroCopy =
+				options && options.zeroCopy && options.transaction && !env.writeTxn;
+			// a historical version is looked up from the history
+			let asOf = options && options.asOf;
+			rc = this.lastSize =
+				asOf === undefined
+					? getByBinary(
+							this.dbAddress,
+							this.writeKey(id, keyBytes, 0) + (zeroCopy ? ZERO_COPY_READ : 0),
+							(options && options.ifNotTxnId) || 0,
+							txn.address || 0,
+						)
+					: getAsOfByBinary(
+							this.dbAddress,
+							this.writeKey(id, keyBytes, 0),
+							asOf,
+							txn.address || 0,
+						);
 			if (rc < 0) {
 				if (rc == -30798)
 					// MDB_NOTFOUND
@@ -114,7 +132,7 @@ export function addReadMethods(
 					this.lastSize = keyBytesView.getUint32(0, true);
 					let bufferId = keyBytesView.getUint32(4, true);
 					let bytes = getMMapBuffer(bufferId, this.lastSize);
-					return asSafeBuffer ? Buffer.from(bytes) : bytes;
+					return asSafeBuffer && !zeroCopy ? Buffer.from(bytes) : bytes;
 				} else throw lmdbError(rc);
 			}
 			let compression = this.compression;
@@ -122,12 +140,19 @@ export function addReadMethods(
 			if (rc > bytes.maxLength) {
 				// this means the target buffer wasn't big enough, so the get failed to copy all the data from the database, need to either grow or use special buffer
 				return this._returnLargeBuffer(() =>
-					getByBinary(
-						this.dbAddress,
-						this.writeKey(id, keyBytes, 0),
-						0,
-						txn.address || 0,
-					),
+					asOf === undefined
+						? getByBinary(
+								this.dbAddress,
+								this.writeKey(id, keyBytes, 0),
+								0,
+								txn.address || 0,
+							)
+						: getAsOfByBinary(
+								this.dbAddress,
+								this.writeKey(id, keyBytes, 0),
+								asOf,
+								txn.address || 0,
+							),
 				);
 			}
 			bytes.length = this.lastSize;
@@ -143,7 +168,7 @@ export function addReadMethods(
 			if (!txn.address) {
 				throw new Error('Invalid transaction, it has no address');
 			}
-			let address = recordReadInstruction(
+			recordReadInstruction(
 				txn.address,
 				this.db.dbi,
 				id,
@@ -154,7 +179,9 @@ export function addReadMethods(
 					outstandingReads--;
 					let buffer = mmaps[bufferId];
 					if (!buffer) {
-						buffer = mmaps[bufferId] = getSharedBuffer(bufferId, env.address);
+						buffer = getSharedBuffer(bufferId, env.address);
+						// read results buffers are reclaimed (and their ids reused) once they are no longer referenced
+						if (buffer.isSharedMap) mmaps[bufferId] = buffer;
 					}
 					//console.log({bufferId, offset, size})
 					if (buffer.isSharedMap) {
@@ -165,17 +192,13 @@ export function addReadMethods(
 						bytes.txn = txn;
 						callback(bytes, 0, size);
 					} else {
-						// using copied memory
+						// using copied memory, the callback returns true if it copied the result out, so the
+						// results buffer can be released without waiting for GC
 						txn.done(); // decrement and possibly abort
-						callback(buffer, offset, size);
+						return callback(buffer, offset, size);
 					}
 				},
 			);
-			if (address) {
-				startRead(address, () => {
-					resolveReads();
-				});
-			}
 		},
 		getAsync(id, options, callback) {
 			let promise;
@@ -186,18 +209,29 @@ export function addReadMethods(
 					offset += 8;
 					size -= 8;
 				}
+				if (this.ttl) {
+					// skip the expiration, expired entries are treated as missing
+					if (new DataView(buffer, offset, 8).getFloat64(0, true) <= Date.now()) {
+						callback(undefined);
+						return true;
+					}
+					offset += 8;
+					size -= 8;
+				}
 				let bytes = new Uint8Array(buffer, offset, size);
 				let value;
 				if (this.decoder) {
 					// the decoder potentially uses the data from the buffer in the future and needs a stable buffer
 					value = bytes && this.decoder.decode(bytes);
 				} else if (this.encoding == 'binary') {
-					value = bytes;
+					// small results are copied out of the pooled results buffer
+					value = buffer.isSharedMap ? bytes : bytes.slice();
 				} else {
 					value = Buffer.prototype.utf8Slice.call(bytes, 0, size);
 					if (this.encoding == 'json' && value) value = JSON.parse(value);
 				}
 				callback(value);
+				return !this.decoder;
 			});
 			return promise;
 		},
@@ -373,6 +407,24 @@ export function addReadMethods(
 			}
 		},
 
+		getAsOf(id, version, options) {
+			if (!this.history)
+				throw new Error('getAsOf requires a database opened with the history option');
+			let bytes = this.getBinary(id, Object.assign({}, options, { asOf: version }));
+			if (bytes === undefined) return;
+			let value;
+			if (this.decoder) value = this.decoder.decode(bytes);
+			else if (this.encoding == 'binary') value = bytes;
+			else {
+				value = Buffer.prototype.utf8Slice.call(bytes, 0, bytes.length);
+				if (this.encoding == 'json' && value) value = JSON.parse(value);
+			}
+			return {
+				value,
+				version: getLastVersion(),
+			};
+		},
+
 		directWrite(id, options) {
 			let rc;
 			let txn =
@@ -486,6 +538,26 @@ export function addReadMethods(
 				options ? Object.assign(defaultOptions, options) : defaultOptions,
 			);
 		},
+		getValuesFixed(key, options) {
+			// bulk read of the packed values for a key in a dupFixed database
+			let txn =
+				env.writeTxn ||
+				(options && options.transaction) ||
+				(readTxnRenewed ? readTxn : renewReadTxn(this));
+			let bytes = getValuesFixed(
+				this.dbAddress,
+				this.writeKey(key, keyBytes, 0),
+				txn.address || 0,
+			);
+			let ArrayType = options && options.arrayType;
+			if (ArrayType)
+				return new ArrayType(
+					bytes.buffer,
+					bytes.byteOffset,
+					bytes.length / ArrayType.BYTES_PER_ELEMENT,
+				);
+			return bytes;
+		},
 		getKeys(options) {
 			if (!options) options = {};
 			options.values = false;
@@ -923,6 +995,40 @@ export function addReadMethods(
 			});
 			if (!callback) return new Promise((resolve) => (callback = resolve));
 		},
+		prefetchRange(start, end, maxBytes, callback) {
+			if (typeof maxBytes == 'function') {
+				callback = maxBytes;
+				maxBytes = 0;
+			}
+			// [start key size][start key][end key size][end key], 4-byte aligned
+			let keys = Buffer.allocUnsafeSlow(maxKeySize * 2 + 16);
+			let position = this.writeKey(
+				start === undefined ? DEFAULT_BEGINNING_KEY : start,
+				keys,
+				4,
+			);
+			keys.writeUInt32LE(position - 4, 0);
+			position = (position + 3) & ~3;
+			if (end === undefined) keys.writeUInt32LE(0xffffffff, position);
+			else
+				keys.writeUInt32LE(
+					this.writeKey(end, keys, position + 4) - position - 4,
+					position,
+				);
+			outstandingReads++;
+			prefetchRange(
+				this.dbAddress,
+				getAddress(keys.buffer),
+				maxBytes || 0,
+				(error) => {
+					outstandingReads--;
+					if (error)
+						console.error('Error with prefetch', keys); // partly exists to keep the keys pinned in memory
+					else callback(null);
+				},
+			);
+			if (!callback) return new Promise((resolve) => (callback = resolve));
+		},
 		useReadTransaction() {
 			let txn = readTxnRenewed ? readTxn : renewReadTxn(this);
 			if (!txn.use) {
@@ -1006,6 +1112,9 @@ export function addReadMethods(
 		if (!env.address) {
 			throw new Error('Can not renew a transaction from a closed database');
 		}
+		// changes published before this are visible in the renewed snapshot (caching uses this to know which values
+		// it can cache)
+		if (env.commitFeed) env.readTxnFeedPosition = env.commitFeed[0];
 		if (!readTxn) {
 			let retries = 0;
 			let waitArray;
@@ -1151,21 +1260,48 @@ export function recordReadInstruction(
 	uint32Instructions[(start >> 2) + 2] = dbi;
 	savePosition = (savePosition + 12) & 0xfffffc;
 	instructionsDataView.setFloat64(start, txnAddress, true);
-	let callbackId = addReadCallback(() => {
+	let thisInstructions = uint32Instructions;
+	let read = () => {
 		let position = start >> 2;
 		let rc = thisInstructions[position];
-		callback(
+		let released = callback(
 			rc,
 			thisInstructions[position + 1],
 			thisInstructions[position + 2],
 			thisInstructions[position + 3],
 		);
+		if (released) thisInstructions[position + 2] = READ_RESULT_RELEASED;
+	};
+	// consecutive instructions in the same buffer are submitted together, as one batch per turn
+	if (readBatch && readBatch.instructions !== thisInstructions) submitReadBatch();
+	if (readBatch) readBatch.reads.push(read);
+	else {
+		readBatch = {
+			instructions: thisInstructions,
+			address: instructionsAddress + start,
+			reads: [read],
+		};
+		queueMicrotask(submitReadBatch);
+	}
+}
+let readBatch;
+function submitReadBatch() {
+	let batch = readBatch;
+	if (!batch) return;
+	readBatch = null;
+	let reads = batch.reads;
+	let callbackId = addReadCallback(() => {
+		let error;
+		for (let read of reads) {
+			try {
+				read();
+			} catch (readError) {
+				error = error || readError;
+			}
+		}
+		if (error) throw error;
 	});
-	let thisInstructions = uint32Instructions;
-	//if (start === 0)
-	return startRead(instructionsAddress + start, callbackId, {}, 'read');
-	//else
-	//nextRead(start);
+	startRead(batch.address, reads.length, callbackId, {}, 'read');
 }
 let nextCallbackId = 0;
 let addReadCallback = globalThis.__lmdb_read_callback;
@@ -16,6 +16,9 @@ CursorWrap::CursorWrap(const CallbackInfo& info) : Napi::ObjectWrap<CursorWrap>(
 	this->keyType = LmdbKeyType::StringKey;
 	this->freeKey = nullptr;
 	this->endKey.mv_size = 0; // indicates no end key (yet)
+	this->lastLeafPage = 0;
+	this->leafPagesScanned = 0;
+	this->readAhead = 0;
 	if (info.Length() < 1) {
 		throwError(info.Env(), "Wrong number of arguments");
 		return;
@@ -77,6 +80,10 @@ Value CursorWrap::del(const CallbackInfo& info) {
 	return info.Env().Undefined();
 }
 int CursorWrap::returnEntry(int lastRC, MDB_val &key, MDB_val &data) {
+	while (!lastRC && dw->extendedDbi && dw->extendedDbi->isExpired(data)) {
+		// expired entries are skipped, as if they had already been swept
+		lastRC = mdb_cursor_get(cursor, &key, &data, iteratingOp);
+	}
 	if (lastRC) {
 		if (lastRC == MDB_NOTFOUND)
 			return 0;
@@ -97,7 +104,9 @@ int CursorWrap::returnEntry(int lastRC, MDB_val &key, MDB_val &data) {
 	}
 	char* keyBuffer = dw->ew->keyBuffer;
 	if (flags & INCLUDE_VALUES) {
-		int result = getVersionAndUncompress(data, dw);
+		int result = getVersionAndUncompress(data, dw, mdb_cursor_txn(cursor));
+		if (result < 0)
+			return result;
 		bool fits = true;
 		if (result) {
 			fits = valToBinaryFast(data, dw); // it fit in the global/compression-target buffer
@@ -121,6 +130,26 @@ int CursorWrap::returnEntry(int lastRC, MDB_val &key, MDB_val &data) {
 	return key.mv_size;
 }
 
+// leaf pages a cursor has to iterate through before it is treated as a scan
+const unsigned int SCAN_DETECTION_PAGES = 2;
+/*
+	Tracks the leaf pages that forward iteration moves through, and once the cursor is scanning, reads ahead the
+	following leaf pages. This overrides the random access advice (noReadAhead) just for the pages being scanned.
+*/
+void CursorWrap::trackScan(MDB_val &key) {
+	// keys are in their leaf page, so a new page means the cursor has moved on to the next leaf
+	size_t leafPage = (size_t) key.mv_data & ~((size_t) dw->pageSize - 1);
+	if (leafPage == lastLeafPage)
+		return;
+	lastLeafPage = leafPage;
+	if (++leafPagesScanned < SCAN_DETECTION_PAGES)
+		return;
+	if (readAhead <= dw->scanReadAhead / 2)
+		readAhead = mdb_cursor_readahead(cursor, dw->scanReadAhead);
+	else
+		readAhead--;
+}
+
 const int START_ADDRESS_POSITION = 4064;
 int32_t CursorWrap::doPosition(uint32_t offset, uint32_t keySize, uint64_t endKeyAddress) {
 	//char* keyBuffer = dw->ew->keyBuffer;
@@ -137,6 +166,10 @@ int32_t CursorWrap::doPosition(uint32_t offset, uint32_t keySize, uint64_t endKe
 			return rc;
 		}
 	}
+	// positioning starts a new iteration
+	lastLeafPage = 0;
+	leafPagesScanned = 0;
+	readAhead = 0;
 	if (endKeyAddress) {
 		uint32_t* keyBuffer = (uint32_t*) endKeyAddress;
 		endKey.mv_size = *keyBuffer;
@@ -302,8 +335,11 @@ NAPI_FUNCTION(iterate) {
 	MDB_val key, data;
 	int rc;
 	if (cw->dw->ew->env == nullptr) rc = MDB_BAD_TXN;
-	else
+	else {
 		rc = mdb_cursor_get(cw->cursor, &key, &data, cw->iteratingOp);
+		if (!rc && cw->dw->scanReadAhead && !(cw->flags & REVERSE))
+			cw->trackScan(key);
+	}
 	RETURN_INT32(cw->returnEntry(rc, key, data));
 }
 
@@ -315,6 +351,8 @@ int32_t iterateFFI(double cwPointer) {
 	if (cw->dw->ew->env == nullptr)
 		return MDB_BAD_TXN;
 	int rc = mdb_cursor_get(cw->cursor, &key, &data, cw->iteratingOp);
+	if (!rc && dw->scanReadAhead && !(cw->flags & REVERSE))
+		cw->trackScan(key);
 	return cw->returnEntry(rc, key, data);
 }
 
@@ -339,7 +377,9 @@ NAPI_FUNCTION(getCurrentShared) {
 	int rc = mdb_cursor_get(cw->cursor, &key, &data, MDB_GET_CURRENT);
 	if (rc)
 		RETURN_INT32(cw->returnEntry(rc, key, data));
-	getVersionAndUncompress(data, cw->dw);
+	rc = getVersionAndUncompress(data, cw->dw, mdb_cursor_txn(cw->cursor));
+	if (rc < 0)
+		return throwLmdbError(env, rc);
 	napi_create_external_buffer(env, data.mv_size,
 		(char*) data.mv_data, noopCursor, nullptr, &returnValue);
 	return returnValue;
@@ -1,5 +1,6 @@
 #include "lmdb-js.h"
 #include <cstdio>
+#include <string.h>
 
 using namespace Napi;
 
@@ -11,7 +12,11 @@ DbiWrap::DbiWrap(const Napi::CallbackInfo& info) : ObjectWrap<DbiWrap>(info) {
 	this->compression = nullptr;
 	this->isOpen = false;
 	this->getFast = false;
+	this->extendedDbi = nullptr;
+	this->valueCache = nullptr;
 	this->ew = nullptr;
+	this->scanReadAhead = 0;
+	this->pageSize = 0;
 	EnvWrap *ew;
 	napi_unwrap(info.Env(), info[0], (void**) &ew);
 	this->env = ew->env;
@@ -30,8 +35,60 @@ DbiWrap::DbiWrap(const Napi::CallbackInfo& info) : ObjectWrap<DbiWrap>(info) {
 		napi_unwrap(info.Env(), info[4], (void**) &compression);
 	else
 		compression = nullptr;
+	dbi_extensions_t extensions = { 0, 0, 0, 0, 0 };
+	if (info[5].IsObject()) {
+		Object options = info[5].As<Object>();
+		Napi::Value option = options.Get("valueLogThreshold");
+		if (option.IsNumber())
+			extensions.valueLogThreshold = option.As<Number>().Uint32Value();
+		option = options.Get("valueLogMapSize");
+		if (option.IsNumber())
+			extensions.valueLogMapSize = (mdb_size_t) option.As<Number>().DoubleValue();
+		option = options.Get("dedupThreshold");
+		if (option.IsNumber())
+			extensions.dedupThreshold = option.As<Number>().Uint32Value();
+		option = options.Get("bloomBitsPerKey");
+		if (option.IsNumber())
+			extensions.bloomBitsPerKey = option.As<Number>().Uint32Value();
+		option = options.Get("bloomExpectedKeys");
+		if (option.IsNumber())
+			extensions.bloomExpectedKeys = (mdb_size_t) option.As<Number>().DoubleValue();
+		option = options.Get("indexes");
+		if (option.IsArray()) {
+			Array indexes = option.As<Array>();
+			for (uint32_t i = 0; i < indexes.Length(); i++) {
+				Object index = indexes.Get(i).As<Object>();
+				index_config_t config;
+				config.name = index.Get("name").As<String>().Utf8Value();
+				config.offset = index.Get("offset").As<Number>().Uint32Value();
+				config.length = index.Get("length").As<Number>().Uint32Value();
+				extensions.indexes.push_back(config);
+			}
+		}
+		option = options.Get("history");
+		if (option.IsObject()) {
+			Object history = option.As<Object>();
+			extensions.history = true;
+			option = history.Get("maxVersions");
+			if (option.IsNumber())
+				extensions.historyMaxVersions = option.As<Number>().Uint32Value();
+			option = history.Get("maxAge");
+			if (option.IsNumber())
+				extensions.historyMaxAge = option.As<Number>().DoubleValue();
+		}
+		option = options.Get("ttl");
+		if (option.IsNumber())
+			extensions.ttl = option.As<Number>().DoubleValue();
+		option = options.Get("scanReadAhead");
+		if (option.IsNumber()) {
+			MDB_stat stat;
+			mdb_env_stat(ew->env, &stat);
+			this->pageSize = stat.ms_psize;
+			this->scanReadAhead = option.As<Number>().Uint32Value();
+		}
+	}
 	int rc = this->open(flags, nameBytes, flags & HAS_VERSIONS,
-		keyType, compression);
+		keyType, compression, &extensions);
 	//if (nameBytes)
 		//delete nameBytes;
 	if (rc) {
@@ -64,7 +121,8 @@ DbiWrap::~DbiWrap() {
 }
 
 
-int DbiWrap::open(int flags, char* name, bool hasVersions, LmdbKeyType keyType, Compression* compression) {
+int DbiWrap::open(int flags, char* name, bool hasVersions, LmdbKeyType keyType, Compression* compression,
+		dbi_extensions_t* extensions) {
 	MDB_txn* txn = ew->getReadTxn();
 	this->hasVersions = hasVersions;
 	this->compression = compression;
@@ -80,9 +138,58 @@ int DbiWrap::open(int flags, char* name, bool hasVersions, LmdbKeyType keyType,
 	if (keyType == LmdbKeyType::DefaultKey && name) { // use the fast compare, but can't do it if we have db table/names mixed in
 		mdb_set_compare(txn, dbi, compareFast);
 	}
+	#ifdef MDB_OVERLAPPINGSYNC
+	this->valueCache = ((ExtendedEnv*) mdb_env_get_userctx(env))->valueCache;
+	#endif
+	if (extensions && (extensions->valueLogThreshold || extensions->dedupThreshold || extensions->bloomBitsPerKey ||
+			!extensions->indexes.empty() || extensions->history || extensions->ttl)) {
+		if (flags & MDB_DUPSORT)
+			return EINVAL; // references can't be stored as sorted duplicates
+		if (extensions->history && !hasVersions)
+			return EINVAL; // the history is keyed by version
+		#ifdef MDB_OVERLAPPINGSYNC
+		ExtendedEnv* extended_env = (ExtendedEnv*) mdb_env_get_userctx(env);
+		rc = extended_env->openExtendedDbi(env, txn, dbi, name, hasVersions, extensions, &this->extendedDbi);
+		#else
+		rc = ENOTSUP;
+		#endif
+		if (rc)
+			return rc;
+	}
 	return 0;
 }
 
+Value DbiWrap::compactValueLog(const Napi::CallbackInfo& info) {
+	if (!this->extendedDbi || !this->extendedDbi->valueLog)
+		return throwError(info.Env(), "The database does not have a value log");
+	if (!ew->writeTxn)
+		return throwError(info.Env(), "Compacting a value log must be done in a write transaction");
+	mdb_size_t maxBytes = info[0].IsNumber() ? (mdb_size_t) info[0].As<Number>().DoubleValue() : 0;
+	mdb_size_t until = info[1].IsNumber() ? (mdb_size_t) info[1].As<Number>().DoubleValue() : 0;
+	mdb_size_t position = 0, end = 0;
+	int rc = this->extendedDbi->valueLog->compact(ew->writeTxn->txn, dbi, extendedDbi->headerSize(), maxBytes, until,
+		&position, &end);
+	if (rc)
+		return throwLmdbError(info.Env(), rc);
+	Object result = Object::New(info.Env());
+	result.Set("position", Number::New(info.Env(), (double) position));
+	result.Set("end", Number::New(info.Env(), (double) end));
+	return result;
+}
+
+Value DbiWrap::sweepExpired(const Napi::CallbackInfo& info) {
+	if (!this->extendedDbi || !this->extendedDbi->ttl)
+		return throwError(info.Env(), "The database does not have a ttl");
+	if (!ew->writeTxn)
+		return throwError(info.Env(), "Sweeping expired entries must be done in a write transaction");
+	unsigned int maxEntries = info[0].IsNumber() ? info[0].As<Number>().Uint32Value() : 0;
+	unsigned int swept;
+	int rc = this->extendedDbi->sweepExpired(ew->writeTxn->txn, dbi, maxEntries, &swept);
+	if (rc)
+		return throwLmdbError(info.Env(), rc);
+	return Number::New(info.Env(), swept);
+}
+
 Value DbiWrap::close(const Napi::CallbackInfo& info) {
 	if (this->isOpen) {
 		mdb_dbi_close(this->env, this->dbi);
@@ -112,7 +219,7 @@ Value DbiWrap::drop(const Napi::CallbackInfo& info) {
 	}
 
 	// Drop database
-	rc = mdb_drop(ew->writeTxn->txn, dbi, del);
+	rc = extendedDbi ? extendedDbi->drop(ew->writeTxn->txn, dbi, del) : mdb_drop(ew->writeTxn->txn, dbi, del);
 	if (rc != 0) {
 		return throwLmdbError(info.Env(), rc);
 	}
@@ -127,7 +234,8 @@ Value DbiWrap::drop(const Napi::CallbackInfo& info) {
 
 Value DbiWrap::stat(const Napi::CallbackInfo& info) {
 	MDB_stat stat;
-	mdb_stat(this->ew->getReadTxn(), dbi, &stat);
+	MDB_txn* txn = this->ew->getReadTxn();
+	mdb_stat(txn, dbi, &stat);
 	Object stats = Object::New(info.Env());
 	stats.Set("pageSize", Number::New(info.Env(), stat.ms_psize));
 	stats.Set("treeDepth", Number::New(info.Env(), stat.ms_depth));
@@ -135,6 +243,15 @@ Value DbiWrap::stat(const Napi::CallbackInfo& info) {
 	stats.Set("treeLeafPageCount", Number::New(info.Env(), stat.ms_leaf_pages));
 	stats.Set("entryCount", Number::New(info.Env(), stat.ms_entries));
 	stats.Set("overflowPages", Number::New(info.Env(), stat.ms_overflow_pages));
+	uint32_t geometry[2];
+	double falsePositiveRate;
+	if (extendedDbi && extendedDbi->bloomBlocks && !extendedDbi->bloomStats(txn, geometry, &falsePositiveRate)) {
+		Object bloomFilter = Object::New(info.Env());
+		bloomFilter.Set("blocks", Number::New(info.Env(), geometry[0]));
+		bloomFilter.Set("hashes", Number::New(info.Env(), geometry[1]));
+		bloomFilter.Set("falsePositiveRate", Number::New(info.Env(), falsePositiveRate));
+		stats.Set("bloomFilter", bloomFilter);
+	}
 	return stats;
 }
 
@@ -142,9 +259,11 @@ int32_t DbiWrap::doGetByBinary(uint32_t keySize, uint32_t ifNotTxnId, int64_t tx
 	char* keyBuffer = ew->keyBuffer;
 	MDB_txn* txn = ew->getReadTxn(txnWrapAddress);
 	MDB_val key, data;
-	key.mv_size = keySize;
+	key.mv_size = keySize & ~ZERO_COPY_READ;
 	key.mv_data = (void*) keyBuffer;
 	uint32_t* currentTxnId = (uint32_t*) (keyBuffer + 32);
+	if (extendedDbi && !extendedDbi->mayContain(txn, &key))
+		return MDB_NOTFOUND; // the Bloom filter says it isn't there, no need to search
 	#ifdef MDB_RPAGE_CACHE
 	int result = mdb_get_with_txn(txn, dbi, &key, &data, (mdb_size_t*) currentTxnId);
 	#else
@@ -155,11 +274,32 @@ int32_t DbiWrap::doGetByBinary(uint32_t keySize, uint32_t ifNotTxnId, int64_t tx
 			return -result;
 		return result;
 	}
+	if (extendedDbi && extendedDbi->isExpired(data))
+		return MDB_NOTFOUND; // waiting to be swept
 	#ifdef MDB_RPAGE_CACHE
 	if (ifNotTxnId && ifNotTxnId == *currentTxnId)
 		return -30004;
 	#endif
-	result = getVersionAndUncompress(data, this);
+	#ifdef MDB_RPAGE_CACHE
+	// only values from committed pages can be cached, a write txn can modify its dirty pages without changing their txn id
+	bool inWriteTxn = txnWrapAddress ? !(((TxnWrap*) txnWrapAddress)->flags & MDB_RDONLY) :
+		ew->writeTxn && txn == ew->writeTxn->txn;
+	result = getVersionAndUncompress(data, this, txn, &key, inWriteTxn ? 0 : *((mdb_size_t*) currentTxnId));
+	#else
+	result = getVersionAndUncompress(data, this, txn);
+	#endif
+	if (result < 0)
+		return result;
+#if ENABLE_V8_API
+	bool zeroCopy = keySize & ZERO_COPY_READ;
+	if (zeroCopy && result == 1 && data.mv_size >= ZERO_COPY_THRESHOLD) {
+		// the caller has pinned the snapshot with its read txn, so the mapped bytes stay valid and don't need
+		// to be copied (remapped chunks are not stable though, and fall back to copying)
+		int32_t rc = EnvWrap::toSharedBuffer(ew->env, (uint32_t*) keyBuffer, data);
+		if (rc == -30001)
+			return rc;
+	}
+#endif
 	bool fits = true;
 	if (result) {
 		fits = valToBinaryFast(data, this); // it fits in the global/compression-target buffer
@@ -192,6 +332,8 @@ NAPI_FUNCTION(directWrite) {
 	GET_UINT32_ARG(dataSize, 3);
 	int64_t txnAddress = 0;
 	napi_status status = napi_get_value_int64(env, args[4], &txnAddress);
+	if (dw->extendedDbi)
+		RETURN_INT32(-EINVAL); // the B-tree may only hold a reference, a full put is needed
 	if (dw->hasVersions) offset += 8;
 	EnvWrap* ew = dw->ew;
 	char* keyBuffer = ew->keyBuffer;
@@ -205,6 +347,11 @@ NAPI_FUNCTION(directWrite) {
 	int result = mdb_direct_write(txn, dw->dbi, &key, offset, &data);
 #else
 	int result = -1;
+#endif
+#ifdef MDB_OVERLAPPINGSYNC
+	ExtendedEnv* extendedEnv = (ExtendedEnv*) mdb_env_get_userctx(ew->env);
+	if (result == 0 && extendedEnv)
+		extendedEnv->recordChange(nullptr, dw->dbi, &key); // it isn't part of a write txn, so it is published now
 #endif
 	RETURN_INT32(result);
 }
@@ -227,6 +374,36 @@ uint32_t getByBinaryFFI(double dwPointer, uint32_t keySize, uint32_t ifNotTxnId,
 	return dw->doGetByBinary(keySize, ifNotTxnId, txnAddress);
 }
 
+// get the entry as of a version, from the dbi or its history, returning the size like getByBinary
+NAPI_FUNCTION(getAsOfByBinary) {
+	ARGS(4)
+	GET_INT64_ARG(0);
+	DbiWrap* dw = (DbiWrap*) i64;
+	uint32_t keySize;
+	GET_UINT32_ARG(keySize, 1);
+	double version;
+	napi_get_value_double(env, args[2], &version);
+	int64_t txnAddress = 0;
+	napi_get_value_int64(env, args[3], &txnAddress);
+	if (!dw->extendedDbi || !dw->hasVersions)
+		RETURN_INT32(-EINVAL);
+	MDB_val key, data;
+	key.mv_size = keySize;
+	key.mv_data = (void*) dw->ew->keyBuffer;
+	MDB_txn* txn = dw->ew->getReadTxn(txnAddress);
+	int rc = dw->extendedDbi->getAsOf(txn, dw->dbi, &key, version, &data);
+	if (rc)
+		RETURN_INT32(rc > 0 ? -rc : rc);
+	if (dw->extendedDbi->isExpired(data))
+		RETURN_INT32(MDB_NOTFOUND);
+	rc = getVersionAndUncompress(data, dw, txn);
+	if (rc < 0)
+		RETURN_INT32(rc);
+	if (rc)
+		valToBinaryFast(data, dw); // if it doesn't fit, the size tells the caller to expand its buffer and retry
+	RETURN_INT32(data.mv_size);
+}
+
 napi_finalize noopDbi = [](napi_env, void *, void *) {
 	// Data belongs to LMDB, we shouldn't free it here
 };
@@ -248,7 +425,11 @@ NAPI_FUNCTION(getSharedByBinary) {
 		} else
 			return throwLmdbError(env, rc);
 	}
-	rc = getVersionAndUncompress(data, dw);
+	if (dw->extendedDbi && dw->extendedDbi->isExpired(data))
+		RETURN_UNDEFINED;
+	rc = getVersionAndUncompress(data, dw, txn);
+	if (rc < 0)
+		return throwLmdbError(env, rc);
 	napi_create_external_buffer(env, data.mv_size,
 		(char*) data.mv_data, noopDbi, nullptr, &returnValue);
 	return returnValue;
@@ -273,7 +454,11 @@ NAPI_FUNCTION(getStringByBinary) {
 		} else
 			return throwLmdbError(env, rc);
 	}
-	rc = getVersionAndUncompress(data, dw);
+	if (dw->extendedDbi && dw->extendedDbi->isExpired(data))
+		RETURN_UNDEFINED;
+	rc = getVersionAndUncompress(data, dw, txn);
+	if (rc < 0)
+		return throwLmdbError(env, rc);
 	if (rc)
 		napi_create_string_utf8(env, (char*) data.mv_data, data.mv_size, &returnValue);
 	else
@@ -281,6 +466,57 @@ NAPI_FUNCTION(getStringByBinary) {
 	return returnValue;
 }
 
+// Bulk read of all the values for a key in a dupFixed database. LMDB stores these values packed
+// in LEAF2 pages, so we can copy a whole page of values at a time with MDB_GET_MULTIPLE/MDB_NEXT_MULTIPLE
+// rather than iterating through each duplicate
+NAPI_FUNCTION(getValuesFixed) {
+	ARGS(3)
+	GET_INT64_ARG(0);
+	DbiWrap* dw = (DbiWrap*) i64;
+	uint32_t keySize;
+	GET_UINT32_ARG(keySize, 1);
+	int64_t txnAddress = 0;
+	napi_get_value_int64(env, args[2], &txnAddress);
+	MDB_txn* txn = dw->ew->getReadTxn(txnAddress);
+	MDB_cursor *cursor;
+	int rc = mdb_cursor_open(txn, dw->dbi, &cursor);
+	if (rc)
+		return throwLmdbError(env, rc);
+	MDB_val key, data;
+	key.mv_size = keySize;
+	key.mv_data = (void*) dw->ew->keyBuffer;
+	size_t count = 0;
+	rc = mdb_cursor_get(cursor, &key, &data, MDB_SET_KEY);
+	if (!rc)
+		rc = mdb_cursor_count(cursor, &count);
+	if (rc && rc != MDB_NOTFOUND) {
+		mdb_cursor_close(cursor);
+		return throwLmdbError(env, rc);
+	}
+	size_t size = rc ? 0 : count * data.mv_size;
+	char* target;
+	napi_create_buffer(env, size, (void**) &target, &returnValue);
+	if (size) {
+		size_t written = 0;
+		// if there is only a single value, there is no sub-database, and data is left as the value from MDB_SET_KEY
+		rc = mdb_cursor_get(cursor, &key, &data, MDB_GET_MULTIPLE);
+		while (!rc && written < size) {
+			size_t length = data.mv_size;
+			if (written + length > size)
+				length = size - written;
+			memcpy(target + written, data.mv_data, length);
+			written += length;
+			rc = mdb_cursor_get(cursor, &key, &data, MDB_NEXT_MULTIPLE);
+		}
+		if (rc && rc != MDB_NOTFOUND) {
+			mdb_cursor_close(cursor);
+			return throwLmdbError(env, rc);
+		}
+	}
+	mdb_cursor_close(cursor);
+	return returnValue;
+}
+
 int DbiWrap::prefetch(uint32_t* keys) {
 	MDB_txn* txn = ExtendedEnv::getPrefetchReadTxn(ew->env);
 	MDB_val key;
@@ -320,13 +556,17 @@ int DbiWrap::prefetch(uint32_t* keys) {
 		int rc = mdb_cursor_get(cursor, &key, &data, findDataValue ? MDB_GET_BOTH : MDB_SET_KEY);
 		findDataValue = false;
 		while (!rc) {
-			// access one byte from each of the pages to ensure they are in the OS cache,
-			// potentially triggering the hard page fault in this thread
-			int pages = (data.mv_size + 0xfff) >> 12;
-			// TODO: Adjust this for the page headers, I believe that makes the first page slightly less 4KB.
-			for (int i = 0; i < pages; i++) {
-				effected += *(((uint8_t*)data.mv_data) + (i << 12));
+			if (extendedDbi) {
+				// fault in the pages of the stored value rather than the reference
+				if (data.mv_size >= extendedDbi->headerSize()) {
+					data.mv_data = (char*) data.mv_data + extendedDbi->headerSize();
+					data.mv_size -= extendedDbi->headerSize();
+				}
+				if (extendedDbi->isReference(data))
+					extendedDbi->resolve(txn, data);
 			}
+			// bring the pages of the value into the OS cache (in this thread)
+			effected += prefetchPages(data.mv_data, data.mv_size);
 			if (findAllValues) // in dupsort databases, access the rest of the values
 				rc = mdb_cursor_get(cursor, &key, &data, MDB_NEXT_DUP);
 			else
@@ -338,6 +578,69 @@ int DbiWrap::prefetch(uint32_t* keys) {
 	return effected;
 }
 
+// leaf pages to read ahead of the cursor in range prefetches
+const unsigned int RANGE_READAHEAD_PAGES = 32;
+const uint32_t NO_RANGE_KEY = 0xffffffff;
+
+/*
+	Walks the entries from the start key up to (but not including) the end key, reading ahead the following leaf
+	pages and bringing the values into the OS cache, until maxBytes (if non-zero) have been visited. The keys are
+	[start key size][start key][end key size][end key], each 4-byte aligned, with a size of NO_RANGE_KEY for no end.
+*/
+int DbiWrap::prefetchRange(uint32_t* keys, mdb_size_t maxBytes) {
+	MDB_txn* txn = ExtendedEnv::getPrefetchReadTxn(ew->env);
+	MDB_cursor *cursor;
+	int rc = mdb_cursor_open(txn, dbi, &cursor);
+	if (rc) {
+		ExtendedEnv::donePrefetchReadTxn(txn);
+		return rc;
+	}
+	MDB_val key, data, end;
+	key.mv_size = *keys;
+	key.mv_data = (void*) (keys + 1);
+	keys += (key.mv_size + 7) >> 2;
+	end.mv_size = *keys;
+	end.mv_data = (void*) (keys + 1);
+	bool hasEnd = end.mv_size != NO_RANGE_KEY;
+	MDB_stat stat;
+	mdb_env_stat(ew->env, &stat);
+	size_t lastLeafPage = 0;
+	unsigned int readAhead = 0;
+	mdb_size_t bytes = 0;
+	int effected = 0;
+	rc = mdb_cursor_get(cursor, &key, &data, MDB_SET_RANGE);
+	while (!rc) {
+		if (hasEnd && mdb_cmp(txn, dbi, &key, &end) >= 0)
+			break;
+		// keys are in their leaf page, so a new page means the cursor has moved on to the next leaf
+		size_t leafPage = (size_t) key.mv_data & ~((size_t) stat.ms_psize - 1);
+		if (leafPage != lastLeafPage) {
+			lastLeafPage = leafPage;
+			if (readAhead <= RANGE_READAHEAD_PAGES / 2)
+				readAhead = mdb_cursor_readahead(cursor, RANGE_READAHEAD_PAGES);
+			else
+				readAhead--;
+		}
+		bytes += key.mv_size + data.mv_size;
+		if (extendedDbi) {
+			// fault in the pages of the stored value rather than the reference
+			if (data.mv_size >= extendedDbi->headerSize()) {
+				data.mv_data = (char*) data.mv_data + extendedDbi->headerSize();
+				data.mv_size -= extendedDbi->headerSize();
+			}
+			if (extendedDbi->isReference(data))
+				extendedDbi->resolve(txn, data);
+		}
+		effected += prefetchPages(data.mv_data, data.mv_size);
+		if (maxBytes && bytes >= maxBytes)
+			break;
+		rc = mdb_cursor_get(cursor, &key, &data, MDB_NEXT);
+	}
+	mdb_cursor_close(cursor);
+	ExtendedEnv::donePrefetchReadTxn(txn);
+	return effected;
+}
+
 class PrefetchWorker : public AsyncWorker {
   public:
 	PrefetchWorker(DbiWrap* dw, uint32_t* keys, const Function& callback)
@@ -357,11 +660,24 @@ class PrefetchWorker : public AsyncWorker {
 		napi_call_function(Env(), Env().Undefined(), Callback().Value(), 1, &arg, &result);
 	}
 
-  private:
+  protected:
 	DbiWrap* dw;
 	uint32_t* keys;
 };
 
+class PrefetchRangeWorker : public PrefetchWorker {
+  public:
+	PrefetchRangeWorker(DbiWrap* dw, uint32_t* keys, mdb_size_t maxBytes, const Function& callback)
+	  : PrefetchWorker(dw, keys, callback), maxBytes(maxBytes) {}
+
+	void Execute() {
+		dw->prefetchRange(keys, maxBytes);
+	}
+
+  private:
+	mdb_size_t maxBytes;
+};
+
 NAPI_FUNCTION(prefetchNapi) {
 	ARGS(3)
 	GET_INT64_ARG(0);
@@ -373,6 +689,19 @@ NAPI_FUNCTION(prefetchNapi) {
 	RETURN_UNDEFINED;
 }
 
+NAPI_FUNCTION(prefetchRangeNapi) {
+	ARGS(4)
+	GET_INT64_ARG(0);
+	DbiWrap* dw = (DbiWrap*) i64;
+	napi_get_value_int64(env, args[1], &i64);
+	uint32_t* keys = (uint32_t*) i64;
+	napi_get_value_int64(env, args[2], &i64);
+	mdb_size_t maxBytes = i64 > 0 ? i64 : 0;
+	PrefetchRangeWorker* worker = new PrefetchRangeWorker(dw, keys, maxBytes, Function(env, args[3]));
+	worker->Queue();
+	RETURN_UNDEFINED;
+}
+
 void DbiWrap::setupExports(Napi::Env env, Object exports) {
 	Function DbiClass = DefineClass(env, "Dbi", {
 		// DbiWrap: Prepare constructor template
@@ -380,13 +709,18 @@ void DbiWrap::setupExports(Napi::Env env, Object exports) {
 		DbiWrap::InstanceMethod("close", &DbiWrap::close),
 		DbiWrap::InstanceMethod("drop", &DbiWrap::drop),
 		DbiWrap::InstanceMethod("stat", &DbiWrap::stat),
+		DbiWrap::InstanceMethod("compactValueLog", &DbiWrap::compactValueLog),
+		DbiWrap::InstanceMethod("sweepExpired", &DbiWrap::sweepExpired),
 	});
 	exports.Set("Dbi", DbiClass);
 	EXPORT_NAPI_FUNCTION("directWrite", directWrite);
 	EXPORT_NAPI_FUNCTION("getByBinary", getByBinary);
+	EXPORT_NAPI_FUNCTION("getAsOfByBinary", getAsOfByBinary);
 	EXPORT_NAPI_FUNCTION("prefetch", prefetchNapi);
+	EXPORT_NAPI_FUNCTION("prefetchRange", prefetchRangeNapi);
 	EXPORT_NAPI_FUNCTION("getStringByBinary", getStringByBinary);
 	EXPORT_NAPI_FUNCTION("getSharedByBinary", getSharedByBinary);
+	EXPORT_NAPI_FUNCTION("getValuesFixed", getValuesFixed);
 	EXPORT_FUNCTION_ADDRESS("getByBinaryPtr", getByBinaryFFI);
 	// TODO: wrap mdb_stat too
 }
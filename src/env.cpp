@@ -12,8 +12,6 @@ using namespace Napi;
 #include <v8.h>
 #endif
 
-MDB_txn* ExtendedEnv::prefetchTxns[20];
-pthread_mutex_t* ExtendedEnv::prefetchTxnsLock;
 env_tracking_t* EnvWrap::envTracking = EnvWrap::initTracking();
 thread_local std::vector<EnvWrap*>* EnvWrap::openEnvWraps = nullptr;
 thread_local js_buffers_t* EnvWrap::sharedBuffers = nullptr;
@@ -26,8 +24,6 @@ void* getSharedBuffers() {
 }
 
 env_tracking_t* EnvWrap::initTracking() {
-	ExtendedEnv::prefetchTxnsLock = new pthread_mutex_t;
-	pthread_mutex_init(ExtendedEnv::prefetchTxnsLock, nullptr);
 	env_tracking_t* tracking = new env_tracking_t;
 	tracking->envsLock = new pthread_mutex_t;
 	pthread_mutex_init(tracking->envsLock, nullptr);
@@ -60,6 +56,7 @@ EnvWrap::EnvWrap(const CallbackInfo& info) : ObjectWrap<EnvWrap>(info) {
 	this->readTxnRenewed = false;
     this->hasWrites = false;
 	this->lastReaderCheck = 0;
+	memset(this->writeQueueStats, 0, sizeof(this->writeQueueStats));
 	this->writingLock = new pthread_mutex_t;
 	this->writingCond = new pthread_cond_t;
 	info.This().As<Object>().Set("address", Number::New(info.Env(), (size_t) this));
@@ -283,6 +280,14 @@ Napi::Value EnvWrap::open(const CallbackInfo& info) {
 	option = options.Get("maxReaders");
 	if (option.IsNumber())
 		maxReaders = option.As<Number>();
+	int readTxnPoolSize = 8;
+	option = options.Get("readTxnPoolSize");
+	if (option.IsNumber())
+		readTxnPoolSize = option.As<Number>();
+	size_t decompressedCacheSize = 0;
+	option = options.Get("decompressedCacheSize");
+	if (option.IsNumber())
+		decompressedCacheSize = (size_t) option.As<Number>().DoubleValue();
 	int maxFreeSpaceToLoad = 50000;
 	option = options.Get("maxFreeSpaceToLoad");
 	if (option.IsNumber())
@@ -305,7 +310,7 @@ Napi::Value EnvWrap::open(const CallbackInfo& info) {
 	}
 
 	napiEnv = info.Env();
-	rc = openEnv(flags, jsFlags, (const char*)pathString.c_str(), (char*) keyBuffer, compression, maxDbs, maxReaders, mapSize, pageSize, maxFreeSpaceToLoad, maxFreeSpaceToRetain, encryptKey.empty() ? nullptr : (char*)encryptKey.c_str());
+	rc = openEnv(flags, jsFlags, (const char*)pathString.c_str(), (char*) keyBuffer, compression, maxDbs, maxReaders, readTxnPoolSize, decompressedCacheSize, mapSize, pageSize, maxFreeSpaceToLoad, maxFreeSpaceToRetain, encryptKey.empty() ? nullptr : (char*)encryptKey.c_str());
 	//delete[] pathBytes;
 	if (rc != 0)
 		return throwLmdbError(info.Env(), rc);
@@ -313,7 +318,8 @@ Napi::Value EnvWrap::open(const CallbackInfo& info) {
 	return info.Env().Undefined();
 }
 int EnvWrap::openEnv(int flags, int jsFlags, const char* path, char* keyBuffer, Compression* compression, int maxDbs,
-		int maxReaders, mdb_size_t mapSize, int pageSize, unsigned int max_free_to_load, unsigned int max_free_to_retain, char* encryptionKey) {
+		int maxReaders, int readTxnPoolSize, size_t valueCacheSize, mdb_size_t mapSize, int pageSize, unsigned int max_free_to_load,
+		unsigned int max_free_to_retain, char* encryptionKey) {
 	this->keyBuffer = keyBuffer;
 	this->compression = compression;
 	this->jsFlags = jsFlags;
@@ -355,7 +361,9 @@ int EnvWrap::openEnv(int flags, int jsFlags, const char* path, char* keyBuffer,
 		flags |= MDB_PREVSNAPSHOT;
 	}
 	mdb_env_set_callback(env, checkExistingEnvs);
-	extended_env = new ExtendedEnv();
+	mdb_env_set_sync_callback(env, ExtendedEnv::syncValueLogs);
+	extended_env = new ExtendedEnv(readTxnPoolSize > 0 ? readTxnPoolSize : 0, valueCacheSize);
+	extended_env->extendedDbis.resize(maxDbs + 2); // include the core dbs
 	mdb_env_set_userctx(env, extended_env);
 	#endif
 
@@ -478,20 +486,81 @@ napi_finalize cleanupLMDB = [](napi_env env, void* data, void* buffer_info) {
 	// Data belongs to LMDB, we shouldn't free it here
 };
 
-napi_finalize cleanupExternal = [](napi_env env, void* data, void* buffer_info) {
-	int32_t id = ((buffer_info_t*) buffer_info)->id;
+int32_t registerBuffer(js_buffers_t* buffers, char* start, buffer_info_t& bufferInfo) {
+	int32_t id;
+	if (!bufferInfo.isSharedMap && !buffers->freeIds.empty()) {
+		id = buffers->freeIds.back();
+		buffers->freeIds.pop_back();
+	} else {
+		id = buffers->nextId++;
+		buffers->buffersById.resize(id + 1);
+	}
+	bufferInfo.id = id;
+	bufferInfo.start = start;
+	bufferInfo.ref = nullptr;
+	bufferInfo.retired = false;
+	bufferInfo.released = false;
+	bufferInfo.resultsEscaped = false;
+	bufferInfo.pendingResults = 0;
+	bufferInfo.liveArrayBuffers = 0;
+	bufferInfo.arrayBuffer = nullptr;
+	// the map nodes are stable, so the slots can point to them
+	buffers->buffersById[id] = &buffers->buffers.emplace(start, bufferInfo).first->second;
+	return id;
+}
+
+buffer_info_t* findBuffer(js_buffers_t* buffers, int32_t id) {
+	if (id < 0 || id >= (int32_t) buffers->buffersById.size())
+		return nullptr;
+	return buffers->buffersById[id];
+}
+
+const size_t MAX_FREE_RESULT_BUFFERS = 16;
+void reclaimResultsBuffer(napi_env env, js_buffers_t* buffers, buffer_info_t* buffer) {
+	if (buffer->isSharedMap || !buffer->retired || buffer->pendingResults > 0)
+		return;
+	if (buffer->ref && !buffer->resultsEscaped && buffer->arrayBuffer) {
+		// JS copied all the results out, so release the memory now instead of waiting for GC. The finalizer
+		// may run during the detach, so it is disassociated first
+		napi_value arrayBuffer;
+		napi_get_reference_value(env, buffer->ref, &arrayBuffer);
+		buffer->arrayBuffer->buffer = nullptr;
+		buffer->arrayBuffer = nullptr;
+		buffer->liveArrayBuffers--;
+		if (arrayBuffer)
+			napi_detach_arraybuffer(env, arrayBuffer);
+	} else if (buffer->ref && !buffer->released) {
+		// no more results will be delivered in this buffer, so it only needs to live as long as JS references it
+		uint32_t count;
+		napi_reference_unref(env, buffer->ref, &count);
+		buffer->released = true;
+	}
+	if (buffer->liveArrayBuffers > 0)
+		return;
+	if (buffer->ref)
+		napi_delete_reference(env, buffer->ref);
+	char* start = buffer->start;
+	if (buffer->end - start == RESULTS_SLAB_SIZE && buffers->freeResultBuffers.size() < MAX_FREE_RESULT_BUFFERS)
+		buffers->freeResultBuffers.push_back(start);
+	else
+		free(start);
+	buffers->buffersById[buffer->id] = nullptr;
+	buffers->freeIds.push_back(buffer->id);
+	buffers->buffers.erase(start);
+}
+
+napi_finalize cleanupExternal = [](napi_env env, void* data, void* array_buffer) {
+	// the ArrayBuffer for read results has been collected, the memory can be reused once the buffer is retired
+	results_array_buffer_t* arrayBuffer = (results_array_buffer_t*) array_buffer;
+	buffer_info_t* buffer = arrayBuffer->buffer;
+	delete arrayBuffer;
+	if (!buffer) // already detached and reclaimed
+		return;
 	pthread_mutex_lock(&EnvWrap::sharedBuffers->modification_lock);
-	for (auto bufferRef = EnvWrap::sharedBuffers->buffers.begin(); bufferRef != EnvWrap::sharedBuffers->buffers.end();) {
-		if (bufferRef->second.id == id) {
-//			fprintf(stderr, "erasing buffer on cleanpu %p\n", bufferRef->first);
-			bufferRef = EnvWrap::sharedBuffers->buffers.erase(bufferRef);
-			break;
-		}
-		bufferRef++;
-	}
+	buffer->arrayBuffer = nullptr;
+	buffer->liveArrayBuffers--;
+	reclaimResultsBuffer(env, EnvWrap::sharedBuffers, buffer);
 	pthread_mutex_unlock(&EnvWrap::sharedBuffers->modification_lock);
-	// We malloc'ed this data so free it
-	free(data);
 };
 
 
@@ -502,69 +571,74 @@ NAPI_FUNCTION(getSharedBuffer) {
 	GET_INT64_ARG(1);
 	EnvWrap* ew = (EnvWrap*) i64;
 	pthread_mutex_lock(&EnvWrap::sharedBuffers->modification_lock);
-	for (auto bufferRef = EnvWrap::sharedBuffers->buffers.begin(); bufferRef != EnvWrap::sharedBuffers->buffers.end(); bufferRef++) {
-		if (bufferRef->second.id == bufferId) {
-			char *start = bufferRef->first;
-			buffer_info_t *buffer = &bufferRef->second;
-			if (buffer->env == ew->env) {
-				//fprintf(stderr, "found existing buffer for %u\n", bufferId);
-				napi_get_reference_value(env, buffer->ref, &returnValue);
-				pthread_mutex_unlock(&EnvWrap::sharedBuffers->modification_lock);
-				return returnValue;
-			}
-			if (buffer->env) {
-				// if for some reason it is different env that didn't get cleaned up
-				napi_value arrayBuffer;
-				//fprintf(stderr, "Changing the env for %u\n", bufferId);
-				napi_get_reference_value(env, buffer->ref, &arrayBuffer);
-				napi_detach_arraybuffer(env, arrayBuffer);
-				napi_delete_reference(env, buffer->ref);
-			}
-			char *end = buffer->end;
-			if (buffer->isSharedMap) // only memory mapped buffers are tied to envs
-				buffer->env = ew->env;
-			size_t size = end - start;
-			if (size > 0x100000000)
-				fprintf(stderr, "Getting invalid shared buffer size %llu from start: %llu to %end: %llu", size, start,
-						end);
-#if ENABLE_V8_API
-			if (buffer->isSharedMap) {
-				// V8 has the onerous requirement that two backing stores can't shared the same pointer
-				// address, and will crash if that happens. Therefore to support access to the LMDB
-				// shared memory we have to ensure that there is only one backing store per shared memory
-				// address, and then multiple ArrayBuffers can share that backing store
-				auto store_ref = EnvWrap::backingStores.find(start);
-				std::shared_ptr<v8::BackingStore> bs;
-				if (store_ref == EnvWrap::backingStores.end()) {
-					bs = v8::ArrayBuffer::NewBackingStore(start, size, cleanupSharedMap, (void*) buffer);
-					// this is the most mysterious part, if we don't create an extra shared pointer to the backing store, it gets deleted
-					// even though the unordered_map is supposed to preserve a reference to it
-					auto permanent_pointer = new std::shared_ptr<v8::BackingStore>(bs);
-					EnvWrap::backingStores.emplace(start, bs);
-					//fprintf(stderr, "Creating a new backing (shared %u) store for %p %p\n", buffer->isSharedMap, start, bs.get());
-				} else {
-					bs = store_ref->second;
-					//fprintf(stderr, "Reusing existing backing store for %p %p\n", start, bs.get());
-				}
-				v8::Local<v8::ArrayBuffer> ab = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), bs);
-				//fprintf(stderr, "Use count for backing store after %p %u\n", start, bs.use_count());
-				returnValue = reinterpret_cast<napi_value>(*ab);
-			} else
-#endif
-			napi_create_external_arraybuffer(env, start, size,
-				 buffer->isSharedMap ? cleanupLMDB : cleanupExternal, (void*) buffer, &returnValue);
-			int64_t result;
-			napi_create_reference(env, returnValue, 1, &buffer->ref);
-			if (buffer->isSharedMap) {
-				napi_adjust_external_memory(env, -(int64_t) size, &result);
-				//fprintf(stderr, "napi_adjust_external_memory adjusted by %llu %llu\n", size, result);
-				napi_value true_value;
-				napi_get_boolean(env, true, &true_value);
-				napi_set_named_property(env, returnValue, "isSharedMap", true_value);
-			}
+	buffer_info_t *buffer = findBuffer(EnvWrap::sharedBuffers, bufferId);
+	if (buffer) {
+		char *start = buffer->start;
+		// read results buffers are held until all their results are delivered, so they can be reused until then
+		if (buffer->isSharedMap ? buffer->env == ew->env : buffer->ref != nullptr) {
+			//fprintf(stderr, "found existing buffer for %u\n", bufferId);
+			napi_get_reference_value(env, buffer->ref, &returnValue);
 			pthread_mutex_unlock(&EnvWrap::sharedBuffers->modification_lock);
 			return returnValue;
 		}
+		if (buffer->env) {
+			// if for some reason it is different env that didn't get cleaned up
+			napi_value arrayBuffer;
+			//fprintf(stderr, "Changing the env for %u\n", bufferId);
+			napi_get_reference_value(env, buffer->ref, &arrayBuffer);
+			napi_detach_arraybuffer(env, arrayBuffer);
+			napi_delete_reference(env, buffer->ref);
+		}
+		char *end = buffer->end;
+		if (buffer->isSharedMap) // only memory mapped buffers are tied to envs
+			buffer->env = ew->env;
+		size_t size = end - start;
+		if (size > 0x100000000)
+			fprintf(stderr, "Getting invalid shared buffer size %llu from start: %llu to %end: %llu", size, start,
+					end);
+#if ENABLE_V8_API
+		if (buffer->isSharedMap) {
+			// V8 has the onerous requirement that two backing stores can't shared the same pointer
+			// address, and will crash if that happens. Therefore to support access to the LMDB
+			// shared memory we have to ensure that there is only one backing store per shared memory
+			// address, and then multiple ArrayBuffers can share that backing store
+			auto store_ref = EnvWrap::backingStores.find(start);
+			std::shared_ptr<v8::BackingStore> bs;
+			if (store_ref == EnvWrap::backingStores.end()) {
+				bs = v8::ArrayBuffer::NewBackingStore(start, size, cleanupSharedMap, (void*) buffer);
+				// this is the most mysterious part, if we don't create an extra shared pointer to the backing store, it gets deleted
+				// even though the unordered_map is supposed to preserve a reference to it
+				auto permanent_pointer = new std::shared_ptr<v8::BackingStore>(bs);
+				EnvWrap::backingStores.emplace(start, bs);
+				//fprintf(stderr, "Creating a new backing (shared %u) store for %p %p\n", buffer->isSharedMap, start, bs.get());
+			} else {
+				bs = store_ref->second;
+				//fprintf(stderr, "Reusing existing backing store for %p %p\n", start, bs.get());
+			}
+			v8::Local<v8::ArrayBuffer> ab = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), bs);
+			//fprintf(stderr, "Use count for backing store after %p %u\n", start, bs.use_count());
+			returnValue = reinterpret_cast<napi_value>(*ab);
+		} else
+#endif
+		if (buffer->isSharedMap)
+			napi_create_external_arraybuffer(env, start, size, cleanupLMDB, (void*) buffer, &returnValue);
+		else {
+			buffer->arrayBuffer = new results_array_buffer_t;
+			buffer->arrayBuffer->buffer = buffer;
+			buffer->liveArrayBuffers++;
+			napi_create_external_arraybuffer(env, start, size, cleanupExternal, (void*) buffer->arrayBuffer, &returnValue);
+		}
+		int64_t result;
+		napi_create_reference(env, returnValue, 1, &buffer->ref);
+		if (buffer->isSharedMap) {
+			napi_adjust_external_memory(env, -(int64_t) size, &result);
+			//fprintf(stderr, "napi_adjust_external_memory adjusted by %llu %llu\n", size, result);
+			napi_value true_value;
+			napi_get_boolean(env, true, &true_value);
+			napi_set_named_property(env, returnValue, "isSharedMap", true_value);
+		}
+		pthread_mutex_unlock(&EnvWrap::sharedBuffers->modification_lock);
+		return returnValue;
 	}
 	pthread_mutex_unlock(&EnvWrap::sharedBuffers->modification_lock);
 	RETURN_UNDEFINED;
@@ -659,8 +733,7 @@ int32_t EnvWrap::toSharedBuffer(MDB_env* env, uint32_t* keyBuffer,  MDB_val data
         bufferInfo.end = (char*) end;
         bufferInfo.env = nullptr;
 		bufferInfo.isSharedMap = true;
-        bufferInfo.id = sharedBuffers->nextId++;
-        sharedBuffers->buffers.emplace((char*)bufferStart, bufferInfo);
+        registerBuffer(sharedBuffers, (char*) bufferStart, bufferInfo);
 	} else {
 		bufferInfo = bufferSearch->second;
 	}
@@ -748,6 +821,8 @@ void EnvWrap::closeEnv(bool hasLock) {
 						int64_t result;
 						if (bufferRef->second.id >= 0)
 							napi_adjust_external_memory(napiEnv, bufferRef->second.end - bufferRef->first, &result);
+						// JS may still have the id cached, so it is not reused
+						EnvWrap::sharedBuffers->buffersById[bufferRef->second.id] = nullptr;
 						bufferRef = EnvWrap::sharedBuffers->buffers.erase(bufferRef);
 					} else
 						bufferRef++;
@@ -851,6 +926,10 @@ Napi::Value EnvWrap::info(const CallbackInfo& info) {
 		stats.Set("writes", Number::New(info.Env(), metrics->writes));
 		stats.Set("puts", Number::New(info.Env(), metrics->puts));
 		stats.Set("deletes", Number::New(info.Env(), metrics->deletes));
+		stats.Set("syncs", Number::New(info.Env(), metrics->syncs));
+		stats.Set("syncedTxns", Number::New(info.Env(), metrics->synced_txns));
+		stats.Set("uringWrites", Number::New(info.Env(), metrics->uring_writes));
+		stats.Set("rangeSyncs", Number::New(info.Env(), metrics->range_syncs));
 	}
 	#endif
 	return stats;
@@ -969,6 +1048,8 @@ Napi::Value EnvWrap::commitTxn(const CallbackInfo& info) {
 	if (currentTxn->flags & TXN_ABORTABLE) {
 		//fprintf(stderr, "txn_commit\n");
 		rc = mdb_txn_commit(currentTxn->txn);
+		if (!currentTxn->parent)
+			ExtendedEnv::publishChanges(env, rc == 0);
 	}
 	this->writeTxn = currentTxn->parent;
 	if (!this->writeTxn) {
@@ -994,6 +1075,8 @@ Napi::Value EnvWrap::abortTxn(const CallbackInfo& info) {
 	TxnTracked *currentTxn = this->writeTxn;
 	if (currentTxn->flags & TXN_ABORTABLE) {
 		mdb_txn_abort(currentTxn->txn);
+		if (!currentTxn->parent)
+			ExtendedEnv::publishChanges(env, false);
 	} else {
 		throwError(info.Env(), "Can not abort this transaction");
 	}
@@ -1017,6 +1100,17 @@ Napi::Value EnvWrap::getWriteTxnId(const Napi::CallbackInfo& info) {
 	} else return throwError(info.Env(), "There is no active write transaction.");
 	return Number::New(info.Env(), txn_id);
 }
+Napi::Value EnvWrap::setWriteFill(const Napi::CallbackInfo& info) {
+	TxnTracked *currentTxn = this->writeTxn;
+	if (!currentTxn)
+		return throwError(info.Env(), "There is no active write transaction.");
+#ifdef MDB_OVERLAPPINGSYNC
+	int rc = mdb_txn_set_fill(currentTxn->txn, info[0].As<Number>().Uint32Value());
+	if (rc)
+		return throwLmdbError(info.Env(), rc);
+#endif
+	return info.Env().Undefined();
+}
 
 
 /*Napi::Value EnvWrap::openDbi(const CallbackInfo& info) {
@@ -1069,13 +1163,47 @@ int32_t writeFFI(double ewPointer, uint64_t instructionAddress) {
 	}
 	return rc;
 }
-ExtendedEnv::ExtendedEnv() {
+/*
+	The commit feed is [position][published txn id][committing txn id][unused] followed by a ring of
+	COMMIT_FEED_ENTRIES [dbi][key hash] entries. Each published txn starts with a [COMMIT_FEED_TXN][txn id] entry
+	(a txn id of 0 for an aborted txn or a direct write), then has an entry for each key it wrote (or a key hash of 0
+	for a dropped or cleared db). The position counts the entries ever published, and is only advanced after a txn's
+	entries are written, so readers that see it change can read up to it (and can tell whether the ring has wrapped
+	past what they last read). The published txn id is the last committed txn the feed accounts for, and the
+	committing txn id is the txn of this process that is being committed (with its changes not published yet), so
+	readers can tell when a txn was committed by another process, without its changes being published.
+*/
+const uint32_t COMMIT_FEED_ENTRIES = 0x4000;
+const uint32_t COMMIT_FEED_TXN = 0xffffffff;
+const int COMMIT_FEED_POSITION = 0;
+const int COMMIT_FEED_PUBLISHED_TXN = 1;
+const int COMMIT_FEED_COMMITTING_TXN = 2;
+const int COMMIT_FEED_HEADER = 4;
+
+ExtendedEnv::ExtendedEnv(unsigned int readTxnPoolSize, size_t valueCacheSize) {
+	this->readTxnPoolSize = readTxnPoolSize;
+	valueCache = valueCacheSize ? new ValueCache(valueCacheSize) : nullptr;
+	commitFeed = new uint32_t[COMMIT_FEED_HEADER + COMMIT_FEED_ENTRIES * 2]();
+	pendingTxnId = 0;
+	pendingOverflow = false;
+	readTxnPool = new std::atomic<MDB_txn*>[readTxnPoolSize];
+	for (unsigned int i = 0; i < readTxnPoolSize; i++)
+		readTxnPool[i] = nullptr;
 	pthread_mutex_init(&locksModificationLock, nullptr);
 	pthread_mutex_init(&userBuffersLock, nullptr);
+	pthread_mutex_init(&extendedDbisLock, nullptr);
+	pthread_mutex_init(&commitFeedLock, nullptr);
 }
 ExtendedEnv::~ExtendedEnv() {
+	for (ExtendedDbi* extendedDbi : extendedDbis)
+		delete extendedDbi;
+	delete[] readTxnPool;
+	delete valueCache;
+	delete[] commitFeed;
 	pthread_mutex_destroy(&locksModificationLock);
 	pthread_mutex_destroy(&userBuffersLock);
+	pthread_mutex_destroy(&extendedDbisLock);
+	pthread_mutex_destroy(&commitFeedLock);
 }
 uint64_t ExtendedEnv::getNextTime() {
 	uint64_t next_time_int = next_time_double();
@@ -1263,51 +1391,196 @@ NAPI_FUNCTION(unlock) {
 	return return_value;
 }
 
+static std::atomic<unsigned int> nextReadTxnSlot(0);
+static unsigned int readTxnSlot() {
+	static thread_local unsigned int slot = nextReadTxnSlot++;
+	return slot;
+}
+
 MDB_txn* ExtendedEnv::getPrefetchReadTxn(MDB_env* env) {
 	MDB_txn* txn;
-	pthread_mutex_lock(prefetchTxnsLock);
-	// try to find an existing txn for this env
-	for (int i = 0; i < 20; i++) {
-		txn = prefetchTxns[i];
-		if (txn && mdb_txn_env(txn) == env) {
-			mdb_txn_renew(txn);
-			prefetchTxns[i] = nullptr; // remove it, no one else can use it
-			pthread_mutex_unlock(prefetchTxnsLock);
-			return txn;
+	#ifdef MDB_OVERLAPPINGSYNC
+	ExtendedEnv* extended_env = (ExtendedEnv*) mdb_env_get_userctx(env);
+	unsigned int size = extended_env ? extended_env->readTxnPoolSize : 0;
+	unsigned int slot = readTxnSlot();
+	// take a txn from the pool, starting with this thread's slot
+	for (unsigned int i = 0; i < size; i++) {
+		std::atomic<MDB_txn*>& pooled = extended_env->readTxnPool[(slot + i) % size];
+		if (!pooled.load(std::memory_order_relaxed))
+			continue;
+		txn = pooled.exchange(nullptr, std::memory_order_acquire);
+		if (txn) {
+			if (mdb_txn_renew(txn) == 0)
+				return txn;
+			mdb_txn_abort(txn);
 		}
 	}
-	pthread_mutex_unlock(prefetchTxnsLock);
+	#endif
 	// couldn't find one, need to create a new transaction
 	mdb_txn_begin(env, nullptr, MDB_RDONLY, &txn);
 	return txn;
 }
 void ExtendedEnv::donePrefetchReadTxn(MDB_txn* txn) {
 	mdb_txn_reset(txn);
-	pthread_mutex_lock(prefetchTxnsLock);
-	// reinsert this transaction
-	MDB_txn* moving;
-	for (int i = 0; i < 20; i++) {
-		moving = prefetchTxns[i];
-		prefetchTxns[i] = txn;
-		if (!moving) break;
-		txn = moving;
+	#ifdef MDB_OVERLAPPINGSYNC
+	ExtendedEnv* extended_env = (ExtendedEnv*) mdb_env_get_userctx(mdb_txn_env(txn));
+	unsigned int size = extended_env ? extended_env->readTxnPoolSize : 0;
+	unsigned int slot = readTxnSlot();
+	// return it to the pool, preferably to this thread's slot
+	for (unsigned int i = 0; i < size; i++) {
+		std::atomic<MDB_txn*>& pooled = extended_env->readTxnPool[(slot + i) % size];
+		MDB_txn* empty = nullptr;
+		if (!pooled.load(std::memory_order_relaxed) && pooled.compare_exchange_strong(empty, txn, std::memory_order_release))
+			return;
 	}
-	// if we are full and one has to be removed, abort it
-	if (moving) mdb_txn_abort(moving);
-	pthread_mutex_unlock(prefetchTxnsLock);
+	#endif
+	// if the pool is full, abort it
+	mdb_txn_abort(txn);
 }
 
 void ExtendedEnv::removeReadTxns(MDB_env* env) {
-	pthread_mutex_lock(prefetchTxnsLock);
-	MDB_txn* txn;
-	for (int i = 0; i < 20; i++) {
-		txn = prefetchTxns[i];
-		if (txn && mdb_txn_env(txn) == env) {
+	#ifdef MDB_OVERLAPPINGSYNC
+	ExtendedEnv* extended_env = (ExtendedEnv*) mdb_env_get_userctx(env);
+	if (!extended_env)
+		return;
+	for (unsigned int i = 0; i < extended_env->readTxnPoolSize; i++) {
+		MDB_txn* txn = extended_env->readTxnPool[i].exchange(nullptr);
+		if (txn)
 			mdb_txn_abort(txn);
-			prefetchTxns[i] = nullptr;
+	}
+	#endif
+}
+
+// FNV-1a, readers compute the same hash of the keys they have cached
+static uint32_t hashChangedKey(MDB_val* key) {
+	if (!key)
+		return 0;
+	uint32_t hash = 0x811c9dc5;
+	unsigned char* bytes = (unsigned char*) key->mv_data;
+	for (size_t i = 0; i < key->mv_size; i++)
+		hash = (hash ^ bytes[i]) * 0x01000193;
+	return hash;
+}
+
+/*
+	Record a key written by the current write txn (a null key is a dropped or cleared db). A key written outside of
+	a write txn (a direct write, with no txn) is published right away.
+*/
+void ExtendedEnv::recordChange(MDB_txn* txn, MDB_dbi dbi, MDB_val* key) {
+	if (!txn) {
+		uint32_t entries[4] = { COMMIT_FEED_TXN, 0, dbi, hashChangedKey(key) };
+		pthread_mutex_lock(&commitFeedLock);
+		publishEntries(entries, 2);
+		pthread_mutex_unlock(&commitFeedLock);
+		return;
+	}
+	if (pendingOverflow)
+		return;
+	if (pendingChanges.empty()) {
+		pendingTxnId = (uint32_t) mdb_txn_id(txn);
+		pendingChanges.push_back(COMMIT_FEED_TXN);
+		pendingChanges.push_back(pendingTxnId);
+		std::atomic_store_explicit((std::atomic<uint32_t>*) (commitFeed + COMMIT_FEED_COMMITTING_TXN), pendingTxnId,
+			std::memory_order_release);
+	}
+	if (pendingChanges.size() >= COMMIT_FEED_ENTRIES * 2) {
+		// more than the ring can hold, readers will just have to clear their caches
+		pendingOverflow = true;
+		return;
+	}
+	pendingChanges.push_back(dbi);
+	pendingChanges.push_back(hashChangedKey(key));
+}
+
+// write entries into the ring and advance the position past them (with the commit feed lock held)
+void ExtendedEnv::publishEntries(uint32_t* entries, uint32_t count) {
+	uint32_t position = commitFeed[COMMIT_FEED_POSITION];
+	if (entries) {
+		uint32_t* ring = commitFeed + COMMIT_FEED_HEADER;
+		for (uint32_t i = 0; i < count; i++) {
+			uint32_t* entry = ring + (((position + i) & (COMMIT_FEED_ENTRIES - 1)) << 1);
+			entry[0] = entries[i << 1];
+			entry[1] = entries[(i << 1) + 1];
 		}
+	} // else there are too many to write, skipping the count (a full lap) makes readers clear their caches
+	std::atomic_store_explicit((std::atomic<uint32_t>*) (commitFeed + COMMIT_FEED_POSITION), position + count,
+		std::memory_order_release);
+}
+
+/*
+	Publishes the changes of the last write txn, called (under the write lock) once it is committed or aborted,
+	before any of its callbacks are resolved. An aborted txn's id is reused by the next txn, so its changes are
+	published without it (no cached entry is kept by it), which invalidates any values read from it. If a txn was
+	committed since the last one published, other than this one, it was committed by another process (or without
+	its changes being recorded), so readers are told to clear their caches.
+*/
+void ExtendedEnv::publishChanges(uint32_t lastTxnId, bool committed) {
+	pthread_mutex_lock(&commitFeedLock);
+	uint32_t published = commitFeed[COMMIT_FEED_PUBLISHED_TXN];
+	bool unrecorded = published && lastTxnId != published &&
+		!(committed && pendingTxnId == lastTxnId && lastTxnId - published == 1);
+	if (unrecorded || pendingOverflow)
+		publishEntries(nullptr, COMMIT_FEED_ENTRIES + 1);
+	else if (!pendingChanges.empty()) {
+		if (!committed)
+			pendingChanges[1] = 0;
+		publishEntries(pendingChanges.data(), pendingChanges.size() >> 1);
+	}
+	std::atomic_store_explicit((std::atomic<uint32_t>*) (commitFeed + COMMIT_FEED_PUBLISHED_TXN), lastTxnId,
+		std::memory_order_release);
+	std::atomic_store_explicit((std::atomic<uint32_t>*) (commitFeed + COMMIT_FEED_COMMITTING_TXN), 0,
+		std::memory_order_release);
+	pthread_mutex_unlock(&commitFeedLock);
+	pendingChanges.clear();
+	pendingTxnId = 0;
+	pendingOverflow = false;
+}
+
+void ExtendedEnv::publishChanges(MDB_env* env, bool committed) {
+	#ifdef MDB_OVERLAPPINGSYNC
+	ExtendedEnv* extended_env = (ExtendedEnv*) mdb_env_get_userctx(env);
+	if (extended_env) {
+		MDB_envinfo info;
+		mdb_env_info(env, &info);
+		extended_env->publishChanges((uint32_t) info.me_last_txnid, committed);
 	}
-	pthread_mutex_unlock(prefetchTxnsLock);
+	#endif
+}
+
+NAPI_FUNCTION(getWriteQueueStats) {
+	ARGS(1)
+	GET_INT64_ARG(0)
+	EnvWrap* ew = (EnvWrap*) i64;
+	napi_create_external_arraybuffer(env, ew->writeQueueStats, sizeof(ew->writeQueueStats), nullptr, nullptr, &returnValue);
+	return returnValue;
+}
+
+NAPI_FUNCTION(getCommitFeed) {
+	ARGS(1)
+	GET_INT64_ARG(0)
+	EnvWrap* ew = (EnvWrap*) i64;
+	ExtendedEnv* extended_env = (ExtendedEnv*) mdb_env_get_userctx(ew->env);
+	if (!extended_env)
+		THROW_ERROR("The commit feed is not available for this environment");
+	MDB_envinfo envInfo;
+	mdb_env_info(ew->env, &envInfo);
+	pthread_mutex_lock(&extended_env->commitFeedLock);
+	// the feed accounts for the txns committed before it is used
+	if (!extended_env->commitFeed[COMMIT_FEED_PUBLISHED_TXN])
+		extended_env->commitFeed[COMMIT_FEED_PUBLISHED_TXN] = (uint32_t) envInfo.me_last_txnid;
+	pthread_mutex_unlock(&extended_env->commitFeedLock);
+	napi_value feed, lastTxnId;
+	napi_create_array_with_length(env, 2, &returnValue);
+	napi_create_external_arraybuffer(env, extended_env->commitFeed, (COMMIT_FEED_HEADER + COMMIT_FEED_ENTRIES * 2) << 2,
+		nullptr, nullptr, &feed);
+	napi_set_element(env, returnValue, 0, feed);
+	// the id of the last committed txn (from any process), in the lock file
+	volatile mdb_size_t* lastTxnIdAddress;
+	if (mdb_env_get_last_txnid(ew->env, &lastTxnIdAddress) == 0) {
+		napi_create_external_arraybuffer(env, (void*) lastTxnIdAddress, sizeof(mdb_size_t), nullptr, nullptr, &lastTxnId);
+		napi_set_element(env, returnValue, 1, lastTxnId);
+	}
+	return returnValue;
 }
 
 void EnvWrap::setupExports(Napi::Env env, Object exports) {
@@ -1320,6 +1593,7 @@ void EnvWrap::setupExports(Napi::Env env, Object exports) {
 		EnvWrap::InstanceMethod("commitTxn", &EnvWrap::commitTxn),
 		EnvWrap::InstanceMethod("abortTxn", &EnvWrap::abortTxn),
 		EnvWrap::InstanceMethod("getWriteTxnId", &EnvWrap::getWriteTxnId),
+		EnvWrap::InstanceMethod("setWriteFill", &EnvWrap::setWriteFill),
 		EnvWrap::InstanceMethod("sync", &EnvWrap::sync),
 		EnvWrap::InstanceMethod("resumeWriting", &EnvWrap::resumeWriting),
 		EnvWrap::InstanceMethod("startWriting", &EnvWrap::startWriting),
@@ -1343,6 +1617,8 @@ void EnvWrap::setupExports(Napi::Env env, Object exports) {
 	EXPORT_NAPI_FUNCTION("getTestRef", getTestRef);
 	EXPORT_NAPI_FUNCTION("getUserSharedBuffer", getUserSharedBuffer);
 	EXPORT_NAPI_FUNCTION("notifyUserCallbacks", notifyUserCallbacks);
+	EXPORT_NAPI_FUNCTION("getCommitFeed", getCommitFeed);
+	EXPORT_NAPI_FUNCTION("getWriteQueueStats", getWriteQueueStats);
 	EXPORT_NAPI_FUNCTION("attemptLock", attemptLock);
 	EXPORT_NAPI_FUNCTION("unlock", unlock);
 	EXPORT_FUNCTION_ADDRESS("writePtr", writeFFI);
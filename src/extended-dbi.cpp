@@ -0,0 +1,1015 @@
+#include "lmdb-js.h"
+#include <math.h>
+#include <string.h>
+#include <string>
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+using namespace Napi;
+
+// blob keys are the (big-endian) hash followed by a byte for the kind of entry
+const uint8_t BLOB_VALUE = 0;
+const uint8_t BLOB_COUNT = 1;
+const int MAX_BLOB_PROBES = 64;
+// the Bloom filter dbi has integer keys, with an entry for each filter block (that has any bits set), and the
+// geometry of the filter ([format][blocks][hashes]) under BLOOM_META_KEY. Each block is followed by the geometry
+// ([blocks][hashes]) it was built with, so a filter that has been rebuilt (by another process) can be detected
+const uint32_t BLOOM_BLOCK_SIZE = 512;
+const uint32_t BLOOM_BLOCK_BITS = BLOOM_BLOCK_SIZE * 8;
+const uint32_t BLOOM_ENTRY_SIZE = BLOOM_BLOCK_SIZE + 8;
+const uint32_t BLOOM_META_KEY = 0xffffffff;
+const uint32_t BLOOM_FORMAT = 2;
+const uint32_t MAX_BLOOM_HASHES = 16;
+
+static void blobKey(uint64_t hash, uint8_t kind, uint8_t* target, MDB_val* key) {
+	for (int i = 7; i >= 0; i--) {
+		target[i] = (uint8_t) hash;
+		hash >>= 8;
+	}
+	target[8] = kind;
+	key->mv_data = target;
+	key->mv_size = 9;
+}
+
+// history keys are [key size (uint16 BE)][key][version], so the versions of a key are contiguous, and the version is
+// encoded (big-endian, with the sign bit flipped, or all bits flipped if negative) so that they are in order
+static void historyPrefix(MDB_val* key, std::string& prefix) {
+	prefix.clear();
+	prefix.push_back((char) (key->mv_size >> 8));
+	prefix.push_back((char) key->mv_size);
+	prefix.append((char*) key->mv_data, key->mv_size);
+}
+
+static void appendVersion(std::string& historyKey, double version) {
+	uint64_t bits;
+	memcpy(&bits, &version, 8);
+	bits = (bits & 0x8000000000000000ull) ? ~bits : bits | 0x8000000000000000ull;
+	for (int shift = 56; shift >= 0; shift -= 8)
+		historyKey.push_back((char) (bits >> shift));
+}
+
+static double readVersion(MDB_val& historyKey) {
+	uint8_t* bytes = (uint8_t*) historyKey.mv_data + historyKey.mv_size - 8;
+	uint64_t bits = 0;
+	for (int i = 0; i < 8; i++)
+		bits = (bits << 8) | bytes[i];
+	bits = (bits & 0x8000000000000000ull) ? bits & ~0x8000000000000000ull : ~bits;
+	double version;
+	memcpy(&version, &bits, 8);
+	return version;
+}
+
+static bool isHistoryOf(MDB_val& historyKey, std::string& prefix) {
+	return historyKey.mv_size == prefix.size() + 8 && !memcmp(historyKey.mv_data, prefix.data(), prefix.size());
+}
+
+// all of a key's bits are in one block (so a lookup reads one block), at positions from double hashing
+static uint32_t bloomBits(MDB_val* key, uint32_t blocks, uint32_t hashes, uint32_t* bits) {
+	uint64_t hash = XXH64(key->mv_data, key->mv_size, 0);
+	uint32_t block = (uint32_t) (((hash >> 32) * blocks) >> 32);
+	uint32_t h1 = (uint32_t) hash;
+	uint32_t h2 = (uint32_t) ((hash * 0x9e3779b97f4a7c15ull) >> 32) | 1;
+	for (uint32_t i = 0; i < hashes; i++)
+		bits[i] = (h1 + i * h2) & (BLOOM_BLOCK_BITS - 1);
+	return block;
+}
+
+ExtendedDbi::ExtendedDbi() {
+	this->hasVersions = false;
+	this->valueLog = nullptr;
+	this->blobDbi = 0;
+	this->dedupThreshold = 0;
+	this->bloomDbi = 0;
+	this->bloomBlocks = 0;
+	this->bloomHashes = 0;
+	this->historyDbi = 0;
+	this->historyMaxVersions = 0;
+	this->historyMaxAge = 0;
+	this->ttl = 0;
+	this->expiryDbi = 0;
+}
+
+ExtendedDbi::~ExtendedDbi() {
+	delete valueLog;
+}
+
+bool ExtendedDbi::resolve(MDB_txn* txn, MDB_val& data) {
+	if (*((uint8_t*) data.mv_data) == VALUE_LOG_REFERENCE)
+		return valueLog->resolve(data);
+	uint64_t hash;
+	memcpy(&hash, (char*) data.mv_data + 8, 8);
+	uint8_t keyBytes[9];
+	MDB_val key;
+	blobKey(hash, BLOB_VALUE, keyBytes, &key);
+	return txn && mdb_get(txn, blobDbi, &key, &data) == 0;
+}
+
+/*
+	Store the value in the blob dbi (once for each distinct value), incrementing its reference count, and
+	write the reference to be stored in the dbi. Hash collisions are resolved by probing the following hashes.
+*/
+int ExtendedDbi::storeBlob(MDB_txn* txn, MDB_val& value, char* reference) {
+	uint64_t hash = XXH64(value.mv_data, value.mv_size, 0);
+	uint8_t keyBytes[9];
+	MDB_val key, existing, count;
+	uint64_t references;
+	int rc;
+	for (int probe = 0;; probe++) {
+		if (probe == MAX_BLOB_PROBES)
+			return EEXIST;
+		blobKey(hash, BLOB_VALUE, keyBytes, &key);
+		rc = mdb_get(txn, blobDbi, &key, &existing);
+		if (rc == MDB_NOTFOUND) {
+			rc = mdb_put(txn, blobDbi, &key, &value, 0);
+			references = 0;
+			break;
+		}
+		if (rc)
+			return rc;
+		if (existing.mv_size == value.mv_size && !memcmp(existing.mv_data, value.mv_data, value.mv_size)) {
+			blobKey(hash, BLOB_COUNT, keyBytes, &key);
+			rc = mdb_get(txn, blobDbi, &key, &count);
+			if (rc == 0)
+				memcpy(&references, count.mv_data, 8);
+			else if (rc == MDB_NOTFOUND)
+				references = 0;
+			rc = rc == MDB_NOTFOUND ? 0 : rc;
+			break;
+		}
+		hash++; // a different value with the same hash
+	}
+	if (rc)
+		return rc;
+	references++;
+	blobKey(hash, BLOB_COUNT, keyBytes, &key);
+	count.mv_data = &references;
+	count.mv_size = 8;
+	rc = mdb_put(txn, blobDbi, &key, &count, 0);
+	if (rc)
+		return rc;
+	memset(reference, 0, 4);
+	*((uint8_t*) reference) = DEDUP_REFERENCE;
+	uint32_t size = value.mv_size;
+	memcpy(reference + 4, &size, 4);
+	memcpy(reference + 8, &hash, 8);
+	return 0;
+}
+
+// decrement the reference count of a blob, removing it once it is no longer referenced
+int ExtendedDbi::releaseBlob(MDB_txn* txn, char* reference) {
+	uint64_t hash;
+	memcpy(&hash, reference + 8, 8);
+	uint8_t keyBytes[9];
+	MDB_val key, count;
+	blobKey(hash, BLOB_COUNT, keyBytes, &key);
+	int rc = mdb_get(txn, blobDbi, &key, &count);
+	if (rc)
+		return rc == MDB_NOTFOUND ? 0 : rc;
+	uint64_t references;
+	memcpy(&references, count.mv_data, 8);
+	if (references > 1) {
+		references--;
+		count.mv_data = &references;
+		count.mv_size = 8;
+		return mdb_put(txn, blobDbi, &key, &count, 0);
+	}
+	rc = mdb_del(txn, blobDbi, &key, nullptr);
+	if (rc)
+		return rc;
+	blobKey(hash, BLOB_VALUE, keyBytes, &key);
+	rc = mdb_del(txn, blobDbi, &key, nullptr);
+	return rc == MDB_NOTFOUND ? 0 : rc;
+}
+
+// copy the dedup reference of the existing entry (if it is one), returns MDB_NOTFOUND if there is no entry
+int ExtendedDbi::getExistingReference(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, char* reference) {
+	reference[0] = 0;
+	if (!blobDbi)
+		return 0;
+	MDB_val existing;
+	int rc = mdb_get(txn, dbi, key, &existing);
+	if (rc)
+		return rc;
+	if (existing.mv_size >= headerSize()) {
+		existing.mv_data = (char*) existing.mv_data + headerSize();
+		existing.mv_size -= headerSize();
+	}
+	if (existing.mv_size == EXTERNAL_REFERENCE_SIZE && *((uint8_t*) existing.mv_data) == DEDUP_REFERENCE)
+		memcpy(reference, existing.mv_data, EXTERNAL_REFERENCE_SIZE);
+	return 0;
+}
+
+static std::string extractIndexKey(MDB_val* value, index_extractor_t& index) {
+	if (!value || value->mv_size <= index.offset)
+		return std::string(); // no index entry
+	size_t length = value->mv_size - index.offset;
+	if (length > index.length)
+		length = index.length;
+	return std::string((char*) value->mv_data + index.offset, length);
+}
+
+// copy the index keys of the existing entry (which may be overwritten by the write), empty if there is no entry
+int ExtendedDbi::getIndexKeys(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, std::vector<std::string>& indexKeys) {
+	MDB_val existing;
+	int rc = mdb_get(txn, dbi, key, &existing);
+	if (rc && rc != MDB_NOTFOUND)
+		return rc;
+	bool found = rc == 0;
+	if (found) {
+		existing.mv_data = (char*) existing.mv_data + headerSize();
+		existing.mv_size = existing.mv_size >= headerSize() ? existing.mv_size - headerSize() : 0;
+	}
+	if (found && isReference(existing) && !resolve(txn, existing))
+		return MDB_CORRUPTED;
+	indexKeys.resize(indexes.size());
+	for (size_t i = 0; i < indexes.size(); i++)
+		indexKeys[i] = extractIndexKey(found ? &existing : nullptr, indexes[i]);
+	return 0;
+}
+
+// move the primary key from the old to the new index keys (a null value is a deleted entry)
+int ExtendedDbi::updateIndexes(MDB_txn* txn, MDB_val* key, std::vector<std::string>& oldIndexKeys, MDB_val* value,
+		size_t first) {
+	for (size_t i = first; i < indexes.size(); i++) {
+		std::string indexKey = extractIndexKey(value, indexes[i]);
+		std::string& oldIndexKey = oldIndexKeys[i];
+		if (indexKey == oldIndexKey)
+			continue;
+		MDB_val indexEntry;
+		int rc;
+		if (!oldIndexKey.empty()) {
+			indexEntry.mv_data = (void*) oldIndexKey.data();
+			indexEntry.mv_size = oldIndexKey.size();
+			rc = mdb_del(txn, indexes[i].dbi, &indexEntry, key);
+			if (rc && rc != MDB_NOTFOUND)
+				return rc;
+		}
+		if (!indexKey.empty()) {
+			indexEntry.mv_data = (void*) indexKey.data();
+			indexEntry.mv_size = indexKey.size();
+			MDB_val primaryKey = *key;
+			rc = mdb_put(txn, indexes[i].dbi, &indexEntry, &primaryKey, MDB_NODUPDATA);
+			if (rc && rc != MDB_KEYEXIST)
+				return rc;
+		}
+	}
+	return 0;
+}
+
+/*
+	Open the index dbis (as sorted duplicates of primary keys). An index that is new (empty while the dbi has
+	entries) is built from the existing entries.
+*/
+int ExtendedDbi::openIndexes(MDB_txn* txn, MDB_dbi dbi, std::vector<index_config_t>& configs, bool canWrite) {
+	size_t firstNew = indexes.size();
+	bool needsBuild = false;
+	for (index_config_t& config : configs) {
+		index_extractor_t index;
+		index.offset = config.offset;
+		index.length = config.length;
+		int rc = mdb_dbi_open(txn, config.name.c_str(), MDB_DUPSORT | (canWrite ? MDB_CREATE : 0), &index.dbi);
+		if (rc == MDB_NOTFOUND && !canWrite)
+			continue; // nothing to read or maintain
+		if (rc)
+			return rc;
+		bool open = false;
+		for (index_extractor_t& existing : indexes) {
+			if (existing.dbi == index.dbi)
+				open = true;
+		}
+		if (open)
+			continue; // already opened by another thread or store
+		MDB_stat stat;
+		rc = mdb_stat(txn, index.dbi, &stat);
+		if (rc)
+			return rc;
+		if (stat.ms_entries == 0 && canWrite)
+			needsBuild = true;
+		indexes.push_back(index);
+	}
+	if (!needsBuild)
+		return 0;
+	MDB_cursor* cursor;
+	int rc = mdb_cursor_open(txn, dbi, &cursor);
+	if (rc)
+		return rc;
+	MDB_val key, data;
+	std::vector<std::string> noIndexKeys(indexes.size());
+	rc = mdb_cursor_get(cursor, &key, &data, MDB_FIRST);
+	while (rc == 0) {
+		data.mv_data = (char*) data.mv_data + headerSize();
+		data.mv_size = data.mv_size >= headerSize() ? data.mv_size - headerSize() : 0;
+		if (isReference(data) && !resolve(txn, data)) {
+			rc = MDB_CORRUPTED;
+			break;
+		}
+		// only adds to the new indexes (existing ones already have their entries)
+		rc = updateIndexes(txn, &key, noIndexKeys, &data, firstNew);
+		if (rc)
+			break;
+		rc = mdb_cursor_get(cursor, &key, &data, MDB_NEXT);
+	}
+	mdb_cursor_close(cursor);
+	return rc == MDB_NOTFOUND ? 0 : rc;
+}
+
+static double currentTime() {
+	uint64_t bits = next_time_double();
+	double time;
+	memcpy(&time, &bits, 8);
+	return time;
+}
+
+bool ExtendedDbi::isExpired(MDB_val& entry) {
+	if (!ttl || entry.mv_size < headerSize())
+		return false;
+	double expiration;
+	memcpy(&expiration, (char*) entry.mv_data + headerSize() - 8, 8);
+	return expiration <= currentTime();
+}
+
+double ExtendedDbi::getExpiration(MDB_txn* txn, MDB_dbi dbi, MDB_val* key) {
+	MDB_val existing;
+	double expiration = 0;
+	if (mdb_get(txn, dbi, key, &existing) == 0 && existing.mv_size >= headerSize())
+		memcpy(&expiration, (char*) existing.mv_data + headerSize() - 8, 8);
+	return expiration;
+}
+
+// expiry keys are the expiration (encoded like history versions, so they are in order) followed by the key
+int ExtendedDbi::updateExpiry(MDB_txn* txn, MDB_val* key, double previousExpiration, double expiration) {
+	if (!expiryDbi)
+		return 0;
+	std::string expiryKey;
+	MDB_val entryKey, empty;
+	empty.mv_data = nullptr;
+	empty.mv_size = 0;
+	int rc = 0;
+	if (previousExpiration) {
+		appendVersion(expiryKey, previousExpiration);
+		expiryKey.append((char*) key->mv_data, key->mv_size);
+		entryKey.mv_data = (void*) expiryKey.data();
+		entryKey.mv_size = expiryKey.size();
+		rc = mdb_del(txn, expiryDbi, &entryKey, nullptr);
+		if (rc && rc != MDB_NOTFOUND)
+			return rc;
+		rc = 0;
+	}
+	if (expiration) {
+		expiryKey.clear();
+		appendVersion(expiryKey, expiration);
+		expiryKey.append((char*) key->mv_data, key->mv_size);
+		entryKey.mv_data = (void*) expiryKey.data();
+		entryKey.mv_size = expiryKey.size();
+		rc = mdb_put(txn, expiryDbi, &entryKey, &empty, 0);
+	}
+	return rc;
+}
+
+/*
+	Delete the entries that have expired, oldest expiration first, up to the max entries (so each sweep is a small
+	write). The keys are copied first, since deleting them updates the expiry dbi.
+*/
+int ExtendedDbi::sweepExpired(MDB_txn* txn, MDB_dbi dbi, unsigned int maxEntries, unsigned int* swept) {
+	*swept = 0;
+	if (!expiryDbi)
+		return 0;
+	MDB_cursor* cursor;
+	int rc = mdb_cursor_open(txn, expiryDbi, &cursor);
+	if (rc)
+		return rc;
+	double now = currentTime();
+	std::vector<std::pair<double, std::string>> expired;
+	MDB_val expiryKey, empty;
+	rc = mdb_cursor_get(cursor, &expiryKey, &empty, MDB_FIRST);
+	while (rc == 0 && expired.size() < maxEntries && expiryKey.mv_size > 8) {
+		MDB_val expirationBytes = expiryKey;
+		expirationBytes.mv_size = 8;
+		double expiration = readVersion(expirationBytes);
+		if (expiration > now)
+			break;
+		expired.emplace_back(expiration, std::string((char*) expiryKey.mv_data + 8, expiryKey.mv_size - 8));
+		rc = mdb_cursor_get(cursor, &expiryKey, &empty, MDB_NEXT);
+	}
+	mdb_cursor_close(cursor);
+	if (rc && rc != MDB_NOTFOUND)
+		return rc;
+	for (auto& entry : expired) {
+		MDB_val key;
+		key.mv_data = (void*) entry.second.data();
+		key.mv_size = entry.second.size();
+		rc = del(txn, dbi, &key);
+		if (rc == MDB_NOTFOUND) // the entry is already gone, just remove its expiry entry
+			rc = updateExpiry(txn, &key, entry.first, 0);
+		if (rc)
+			return rc;
+		(*swept)++;
+	}
+	return 0;
+}
+
+// copy the existing entry (its header and resolved value), since it will be overwritten, empty if there is none
+int ExtendedDbi::getPrevious(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, std::string& previous) {
+	MDB_val existing;
+	int rc = mdb_get(txn, dbi, key, &existing);
+	if (rc)
+		return rc == MDB_NOTFOUND ? 0 : rc;
+	if (existing.mv_size < headerSize() || existing.mv_size < 8)
+		return 0;
+	previous.assign((char*) existing.mv_data, headerSize());
+	existing.mv_data = (char*) existing.mv_data + headerSize();
+	existing.mv_size -= headerSize();
+	if (isReference(existing) && !resolve(txn, existing))
+		return MDB_CORRUPTED;
+	previous.append((char*) existing.mv_data, existing.mv_size);
+	return 0;
+}
+
+// move the superseded entry into the history, unless it is being rewritten with the same version
+int ExtendedDbi::archive(MDB_txn* txn, MDB_val* key, std::string& previous, bool setVersion, double version) {
+	if (previous.empty())
+		return 0;
+	double previousVersion;
+	memcpy(&previousVersion, previous.data(), 8);
+	if (setVersion && previousVersion == version)
+		return 0;
+	std::string prefix;
+	historyPrefix(key, prefix);
+	std::string historyKey = prefix;
+	appendVersion(historyKey, previousVersion);
+	MDB_val entryKey, entry;
+	entryKey.mv_data = (void*) historyKey.data();
+	entryKey.mv_size = historyKey.size();
+	entry.mv_data = (void*) previous.data();
+	entry.mv_size = previous.size();
+	int rc = mdb_put(txn, historyDbi, &entryKey, &entry, 0);
+	if (rc)
+		return rc;
+	return pruneHistory(txn, prefix, setVersion && version > previousVersion ? version : previousVersion);
+}
+
+// move the removed entry into the history, after a tombstone (an empty entry) just after its version, so that it is
+// missing as of any later version
+int ExtendedDbi::archiveRemoval(MDB_txn* txn, MDB_val* key, std::string& previous) {
+	if (previous.empty())
+		return 0;
+	double previousVersion;
+	memcpy(&previousVersion, previous.data(), 8);
+	std::string historyKey;
+	historyPrefix(key, historyKey);
+	appendVersion(historyKey, nextafter(previousVersion, INFINITY));
+	MDB_val entryKey, tombstone;
+	entryKey.mv_data = (void*) historyKey.data();
+	entryKey.mv_size = historyKey.size();
+	tombstone.mv_data = (void*) previous.data();
+	tombstone.mv_size = 0;
+	int rc = mdb_put(txn, historyDbi, &entryKey, &tombstone, 0);
+	if (rc)
+		return rc;
+	return archive(txn, key, previous, false, 0);
+}
+
+// archive all the entries as removed, before the dbi is cleared
+int ExtendedDbi::archiveAll(MDB_txn* txn, MDB_dbi dbi) {
+	MDB_cursor* cursor;
+	int rc = mdb_cursor_open(txn, dbi, &cursor);
+	if (rc)
+		return rc;
+	MDB_val key, data;
+	std::string previous;
+	rc = mdb_cursor_get(cursor, &key, &data, MDB_FIRST);
+	while (rc == 0) {
+		previous.clear();
+		rc = getPrevious(txn, dbi, &key, previous);
+		if (rc == 0)
+			rc = archiveRemoval(txn, &key, previous);
+		if (rc == 0)
+			rc = mdb_cursor_get(cursor, &key, &data, MDB_NEXT);
+	}
+	mdb_cursor_close(cursor);
+	return rc == MDB_NOTFOUND ? 0 : rc;
+}
+
+// remove the oldest versions of the key beyond the max count or age (relative to the newest version)
+int ExtendedDbi::pruneHistory(MDB_txn* txn, std::string& prefix, double newestVersion) {
+	if (!historyMaxVersions && !historyMaxAge)
+		return 0;
+	MDB_cursor* cursor;
+	int rc = mdb_cursor_open(txn, historyDbi, &cursor);
+	if (rc)
+		return rc;
+	MDB_val historyKey, entry;
+	size_t count = 0;
+	historyKey.mv_data = (void*) prefix.data();
+	historyKey.mv_size = prefix.size();
+	rc = mdb_cursor_get(cursor, &historyKey, &entry, MDB_SET_RANGE);
+	while (rc == 0 && isHistoryOf(historyKey, prefix)) {
+		count++;
+		rc = mdb_cursor_get(cursor, &historyKey, &entry, MDB_NEXT);
+	}
+	size_t excess = historyMaxVersions && count > historyMaxVersions ? count - historyMaxVersions : 0;
+	historyKey.mv_data = (void*) prefix.data();
+	historyKey.mv_size = prefix.size();
+	rc = mdb_cursor_get(cursor, &historyKey, &entry, MDB_SET_RANGE);
+	// the versions are in order, so the pruned ones are all at the start
+	while (rc == 0 && isHistoryOf(historyKey, prefix) &&
+			(excess > 0 || (historyMaxAge && readVersion(historyKey) < newestVersion - historyMaxAge))) {
+		rc = mdb_cursor_del(cursor, 0);
+		if (rc)
+			break;
+		if (excess > 0)
+			excess--;
+		rc = mdb_cursor_get(cursor, &historyKey, &entry, MDB_GET_CURRENT);
+	}
+	mdb_cursor_close(cursor);
+	return rc == MDB_NOTFOUND ? 0 : rc;
+}
+
+int ExtendedDbi::getAsOf(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, double version, MDB_val* data) {
+	int rc = mdb_get(txn, dbi, key, data);
+	if (rc && rc != MDB_NOTFOUND)
+		return rc;
+	if (rc == 0 && data->mv_size >= 8) {
+		double currentVersion;
+		memcpy(&currentVersion, data->mv_data, 8);
+		if (currentVersion <= version)
+			return 0;
+	}
+	if (!historyDbi)
+		return MDB_NOTFOUND;
+	// find the latest version in the history at or before the requested version
+	std::string prefix;
+	historyPrefix(key, prefix);
+	std::string target = prefix;
+	appendVersion(target, version);
+	MDB_cursor* cursor;
+	rc = mdb_cursor_open(txn, historyDbi, &cursor);
+	if (rc)
+		return rc;
+	MDB_val historyKey;
+	historyKey.mv_data = (void*) target.data();
+	historyKey.mv_size = target.size();
+	rc = mdb_cursor_get(cursor, &historyKey, data, MDB_SET_RANGE);
+	if (rc == 0 && (historyKey.mv_size != target.size() || memcmp(historyKey.mv_data, target.data(), target.size())))
+		rc = mdb_cursor_get(cursor, &historyKey, data, MDB_PREV);
+	else if (rc == MDB_NOTFOUND)
+		rc = mdb_cursor_get(cursor, &historyKey, data, MDB_LAST);
+	mdb_cursor_close(cursor);
+	if (rc == 0 && (!isHistoryOf(historyKey, prefix) || data->mv_size == 0))
+		rc = MDB_NOTFOUND; // no history of the key as of the version, or it had been removed
+	return rc;
+}
+
+int ExtendedDbi::put(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* value, unsigned int flags, bool setVersion, double version) {
+	if (ttl && (flags & MDB_NOOVERWRITE)) {
+		MDB_val existing;
+		if (mdb_get(txn, dbi, key, &existing) == 0 && isExpired(existing))
+			flags &= ~MDB_NOOVERWRITE; // an expired entry is missing, so it is replaced
+	}
+	std::vector<std::string> oldIndexKeys;
+	if (!indexes.empty()) {
+		int rc = getIndexKeys(txn, dbi, key, oldIndexKeys);
+		if (rc)
+			return rc;
+	}
+	std::string previous;
+	if (historyDbi) {
+		int rc = getPrevious(txn, dbi, key, previous);
+		if (rc)
+			return rc;
+	}
+	double previousExpiration = ttl ? getExpiration(txn, dbi, key) : 0;
+	char existingReference[EXTERNAL_REFERENCE_SIZE];
+	int rc = getExistingReference(txn, dbi, key, existingReference);
+	if (rc == 0 && blobDbi && (flags & MDB_NOOVERWRITE))
+		return MDB_KEYEXIST;
+	if (rc && rc != MDB_NOTFOUND)
+		return rc;
+	char reference[EXTERNAL_REFERENCE_SIZE];
+	MDB_val stored = *value;
+	rc = 0;
+	if (blobDbi && (value->mv_size >= dedupThreshold || isReference(*value)))
+		rc = storeBlob(txn, *value, reference);
+	else if (valueLog && (valueLog->shouldStore(*value) || isReference(*value)))
+		rc = valueLog->append(*key, *value, reference);
+	else
+		reference[0] = 0;
+	if (rc)
+		return rc;
+	if (reference[0]) {
+		stored.mv_data = reference;
+		stored.mv_size = EXTERNAL_REFERENCE_SIZE;
+	}
+	std::string expiring;
+	double expiration = 0;
+	if (ttl) {
+		// the expiration goes in the header, before the value (and after the version)
+		expiration = currentTime() + ttl;
+		expiring.assign((char*) &expiration, 8);
+		expiring.append((char*) stored.mv_data, stored.mv_size);
+		stored.mv_data = (void*) expiring.data();
+		stored.mv_size = expiring.size();
+	}
+	if (setVersion)
+		rc = putWithVersion(txn, dbi, key, &stored, flags, version);
+	else
+		rc = mdb_put(txn, dbi, key, &stored, flags);
+	if (rc == 0 && existingReference[0])
+		rc = releaseBlob(txn, existingReference);
+	if (rc == 0 && bloomBlocks)
+		rc = addToBloomFilter(txn, key);
+	if (rc == 0 && !indexes.empty()) {
+		MDB_val indexed = *value;
+		if (isReference(indexed) && !resolve(txn, indexed))
+			return MDB_CORRUPTED;
+		rc = updateIndexes(txn, key, oldIndexKeys, &indexed);
+	}
+	if (rc == 0 && historyDbi)
+		rc = archive(txn, key, previous, setVersion, version);
+	if (rc == 0 && ttl)
+		rc = updateExpiry(txn, key, previousExpiration, expiration);
+	return rc;
+}
+
+int ExtendedDbi::del(MDB_txn* txn, MDB_dbi dbi, MDB_val* key) {
+	std::vector<std::string> oldIndexKeys;
+	if (!indexes.empty()) {
+		int rc = getIndexKeys(txn, dbi, key, oldIndexKeys);
+		if (rc)
+			return rc;
+	}
+	std::string previous;
+	if (historyDbi) {
+		int rc = getPrevious(txn, dbi, key, previous);
+		if (rc)
+			return rc;
+	}
+	double previousExpiration = ttl ? getExpiration(txn, dbi, key) : 0;
+	char existingReference[EXTERNAL_REFERENCE_SIZE];
+	int rc = getExistingReference(txn, dbi, key, existingReference);
+	if (rc)
+		return rc;
+	rc = mdb_del(txn, dbi, key, nullptr);
+	if (rc == 0 && existingReference[0])
+		rc = releaseBlob(txn, existingReference);
+	if (rc == 0 && !indexes.empty())
+		rc = updateIndexes(txn, key, oldIndexKeys, nullptr);
+	if (rc == 0 && historyDbi)
+		rc = archiveRemoval(txn, key, previous);
+	if (rc == 0 && ttl)
+		rc = updateExpiry(txn, key, previousExpiration, 0);
+	return rc;
+}
+
+int ExtendedDbi::drop(MDB_txn* txn, MDB_dbi dbi, int del) {
+	// clearing the dbi removes its entries as of now, deleting it deletes its history too
+	int rc = historyDbi && !del ? archiveAll(txn, dbi) : 0;
+	if (rc == 0)
+		rc = mdb_drop(txn, dbi, del);
+	if (rc == 0 && blobDbi)
+		rc = mdb_drop(txn, blobDbi, 0); // nothing references the blobs anymore
+	for (index_extractor_t& index : indexes) {
+		if (rc == 0)
+			rc = mdb_drop(txn, index.dbi, 0);
+	}
+	if (rc == 0 && historyDbi && del)
+		rc = mdb_drop(txn, historyDbi, 0);
+	if (rc == 0 && expiryDbi)
+		rc = mdb_drop(txn, expiryDbi, 0);
+	if (rc == 0 && bloomBlocks) {
+		// start with an empty filter
+		rc = mdb_drop(txn, bloomDbi, 0);
+		if (rc == 0)
+			rc = writeBloomMeta(txn);
+	}
+	return rc;
+}
+
+bool ExtendedDbi::mayContain(MDB_txn* txn, MDB_val* key) {
+	if (!bloomBlocks)
+		return true;
+	uint32_t geometry[2], block, bits[MAX_BLOOM_HASHES];
+	MDB_val data;
+	int rc = getBloomBlock(txn, key, geometry, &block, bits, &data);
+	if (rc) // no block means no key has been put in it (but if the filter can't be read, we don't know)
+		return rc != MDB_NOTFOUND;
+	uint8_t* bytes = (uint8_t*) data.mv_data;
+	for (uint32_t i = 0; i < geometry[1]; i++) {
+		if (!(bytes[bits[i] >> 3] & (1 << (bits[i] & 7))))
+			return false;
+	}
+	return true;
+}
+
+int ExtendedDbi::addToBloomFilter(MDB_txn* txn, MDB_val* key) {
+	uint32_t geometry[2], block, bits[MAX_BLOOM_HASHES];
+	MDB_val blockKey, data;
+	uint8_t updated[BLOOM_ENTRY_SIZE];
+	int rc = getBloomBlock(txn, key, geometry, &block, bits, &data);
+	if (rc == 0)
+		memcpy(updated, data.mv_data, BLOOM_BLOCK_SIZE);
+	else if (rc == MDB_NOTFOUND || rc == MDB_BAD_VALSIZE)
+		memset(updated, 0, BLOOM_BLOCK_SIZE);
+	else if (rc == MDB_INCOMPATIBLE)
+		return 0; // the filter isn't built in this txn, it will be built (from the keys) when it is next opened
+	else
+		return rc;
+	bool changed = rc != 0;
+	for (uint32_t i = 0; i < geometry[1]; i++) {
+		uint8_t mask = 1 << (bits[i] & 7);
+		if (!(updated[bits[i] >> 3] & mask)) {
+			updated[bits[i] >> 3] |= mask;
+			changed = true;
+		}
+	}
+	if (!changed)
+		return 0; // the bits are already set, don't dirty the page
+	memcpy(updated + BLOOM_BLOCK_SIZE, geometry, 8);
+	blockKey.mv_data = &block;
+	blockKey.mv_size = 4;
+	data.mv_data = updated;
+	data.mv_size = BLOOM_ENTRY_SIZE;
+	return mdb_put(txn, bloomDbi, &blockKey, &data, 0);
+}
+
+// the geometry ([blocks][hashes]) of the filter in the txn, MDB_NOTFOUND if it hasn't been built (in this format)
+int ExtendedDbi::readBloomGeometry(MDB_txn* txn, uint32_t* geometry) {
+	uint32_t metaKey = BLOOM_META_KEY;
+	MDB_val key, meta;
+	key.mv_data = &metaKey;
+	key.mv_size = 4;
+	int rc = mdb_get(txn, bloomDbi, &key, &meta);
+	if (rc)
+		return rc;
+	uint32_t stored[3];
+	if (meta.mv_size < sizeof(stored))
+		return MDB_NOTFOUND;
+	memcpy(stored, meta.mv_data, sizeof(stored));
+	if (stored[0] != BLOOM_FORMAT || !stored[1])
+		return MDB_NOTFOUND;
+	geometry[0] = stored[1];
+	geometry[1] = stored[2] < MAX_BLOOM_HASHES ? stored[2] : MAX_BLOOM_HASHES;
+	return 0;
+}
+
+/*
+	Read the filter block for a key, with the geometry it was built with. If there is no block, or it was built with
+	a different geometry than the one the filter was opened with, the geometry is checked against the meta in this
+	txn, since the filter may have been rebuilt by another process (or this txn's snapshot may be from before it was
+	rebuilt). Returns MDB_NOTFOUND if no key has been put in the block, MDB_BAD_VALSIZE if the block isn't valid, and
+	MDB_INCOMPATIBLE if the filter isn't built in this txn.
+*/
+int ExtendedDbi::getBloomBlock(MDB_txn* txn, MDB_val* key, uint32_t* geometry, uint32_t* block, uint32_t* bits,
+		MDB_val* data) {
+	geometry[0] = bloomBlocks;
+	geometry[1] = bloomHashes;
+	MDB_val blockKey;
+	blockKey.mv_data = block;
+	blockKey.mv_size = 4;
+	for (bool checked = false;; checked = true) {
+		*block = bloomBits(key, geometry[0], geometry[1], bits);
+		int rc = mdb_get(txn, bloomDbi, &blockKey, data);
+		if (rc == 0 && data->mv_size == BLOOM_ENTRY_SIZE &&
+				!memcmp((uint8_t*) data->mv_data + BLOOM_BLOCK_SIZE, geometry, 8))
+			return 0;
+		if (rc && rc != MDB_NOTFOUND)
+			return rc;
+		if (checked)
+			return rc ? rc : MDB_BAD_VALSIZE;
+		uint32_t current[2];
+		int metaRc = readBloomGeometry(txn, current);
+		if (metaRc)
+			return metaRc == MDB_NOTFOUND ? MDB_INCOMPATIBLE : metaRc;
+		if (current[0] == geometry[0] && current[1] == geometry[1])
+			return rc ? rc : MDB_BAD_VALSIZE;
+		geometry[0] = current[0];
+		geometry[1] = current[1];
+	}
+}
+
+int ExtendedDbi::writeBloomMeta(MDB_txn* txn) {
+	uint32_t metaKey = BLOOM_META_KEY;
+	uint32_t geometry[3] = { BLOOM_FORMAT, bloomBlocks, bloomHashes };
+	MDB_val key, meta;
+	key.mv_data = &metaKey;
+	key.mv_size = 4;
+	meta.mv_data = geometry;
+	meta.mv_size = sizeof(geometry);
+	return mdb_put(txn, bloomDbi, &key, &meta, 0);
+}
+
+// add all the existing keys of the dbi to the (empty) filter
+int ExtendedDbi::buildBloomFilter(MDB_txn* txn, MDB_dbi dbi) {
+	std::vector<uint8_t> filter((size_t) bloomBlocks * BLOOM_ENTRY_SIZE);
+	MDB_cursor* cursor;
+	int rc = mdb_cursor_open(txn, dbi, &cursor);
+	if (rc)
+		return rc;
+	MDB_val key, data;
+	uint32_t bits[MAX_BLOOM_HASHES];
+	rc = mdb_cursor_get(cursor, &key, &data, MDB_FIRST);
+	while (rc == 0) {
+		uint8_t* block = filter.data() + (size_t) bloomBits(&key, bloomBlocks, bloomHashes, bits) * BLOOM_ENTRY_SIZE;
+		for (uint32_t i = 0; i < bloomHashes; i++)
+			block[bits[i] >> 3] |= 1 << (bits[i] & 7);
+		rc = mdb_cursor_get(cursor, &key, &data, MDB_NEXT);
+	}
+	mdb_cursor_close(cursor);
+	if (rc != MDB_NOTFOUND)
+		return rc;
+	uint32_t geometry[2] = { bloomBlocks, bloomHashes };
+	for (uint32_t i = 0; i < bloomBlocks; i++) {
+		uint8_t* block = filter.data() + (size_t) i * BLOOM_ENTRY_SIZE;
+		bool empty = true;
+		for (uint32_t j = 0; j < BLOOM_BLOCK_SIZE && empty; j++)
+			empty = !block[j];
+		if (empty)
+			continue;
+		memcpy(block + BLOOM_BLOCK_SIZE, geometry, 8);
+		uint32_t blockNumber = i;
+		key.mv_data = &blockNumber;
+		key.mv_size = 4;
+		data.mv_data = block;
+		data.mv_size = BLOOM_ENTRY_SIZE;
+		rc = mdb_put(txn, bloomDbi, &key, &data, MDB_APPEND);
+		if (rc)
+			return rc;
+	}
+	return 0;
+}
+
+// the geometry of the filter in the txn and its expected false positive rate (from the fraction of bits set in each
+// block), MDB_NOTFOUND if it isn't built
+int ExtendedDbi::bloomStats(MDB_txn* txn, uint32_t* geometry, double* falsePositiveRate) {
+	int rc = readBloomGeometry(txn, geometry);
+	if (rc)
+		return rc;
+	MDB_cursor* cursor;
+	rc = mdb_cursor_open(txn, bloomDbi, &cursor);
+	if (rc)
+		return rc;
+	double total = 0;
+	MDB_val key, data;
+	rc = mdb_cursor_get(cursor, &key, &data, MDB_FIRST);
+	while (rc == 0) {
+		if (key.mv_size == 4 && *(uint32_t*) key.mv_data != BLOOM_META_KEY && data.mv_size == BLOOM_ENTRY_SIZE &&
+				!memcmp((uint8_t*) data.mv_data + BLOOM_BLOCK_SIZE, geometry, 8)) {
+			uint8_t* bytes = (uint8_t*) data.mv_data;
+			uint32_t set = 0;
+			for (uint32_t i = 0; i < BLOOM_BLOCK_SIZE; i++) {
+				for (uint8_t byte = bytes[i]; byte; byte &= byte - 1)
+					set++;
+			}
+			total += pow((double) set / BLOOM_BLOCK_BITS, geometry[1]);
+		}
+		rc = mdb_cursor_get(cursor, &key, &data, MDB_NEXT);
+	}
+	mdb_cursor_close(cursor);
+	if (rc != MDB_NOTFOUND)
+		return rc;
+	*falsePositiveRate = total / geometry[0];
+	return 0;
+}
+
+/*
+	Open the filter's dbi and read its geometry, or if there isn't a filter yet (and we can write), size it for the
+	expected keys (or twice the existing entries, if more) and build it from the existing keys. A filter with more
+	entries than it was sized for (at these bits per key) is rebuilt the same way, since its false positive rate
+	climbs quickly past its capacity.
+*/
+int ExtendedDbi::openBloomFilter(MDB_txn* txn, MDB_dbi dbi, std::string& dbName, bool canWrite, unsigned int bitsPerKey,
+		mdb_size_t expectedKeys) {
+	std::string bloomName = "__bloom:" + dbName;
+	int rc = mdb_dbi_open(txn, bloomName.c_str(), MDB_INTEGERKEY | (canWrite ? MDB_CREATE : 0), &bloomDbi);
+	if (rc)
+		return rc == MDB_NOTFOUND ? 0 : rc; // read-only and the filter was never built
+	uint32_t geometry[2];
+	rc = readBloomGeometry(txn, geometry);
+	if (rc == 0) {
+		bloomBlocks = geometry[0];
+		bloomHashes = geometry[1];
+	} else if (rc != MDB_NOTFOUND)
+		return rc;
+	if (!canWrite)
+		return 0;
+	MDB_stat stat;
+	rc = mdb_stat(txn, dbi, &stat);
+	if (rc)
+		return rc;
+	if (bloomBlocks && stat.ms_entries <= (mdb_size_t) bloomBlocks * BLOOM_BLOCK_BITS / bitsPerKey)
+		return 0;
+	if (expectedKeys < stat.ms_entries * 2)
+		expectedKeys = stat.ms_entries * 2;
+	mdb_size_t blocks = (expectedKeys * bitsPerKey + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS;
+	uint32_t hashes = bitsPerKey * 69 / 100; // optimal number of hashes is bits per key * ln 2
+	uint32_t blockCount = blocks < 1 ? 1 : blocks > 0x10000000 ? 0x10000000 : (uint32_t) blocks;
+	hashes = hashes < 1 ? 1 : hashes > MAX_BLOOM_HASHES ? MAX_BLOOM_HASHES : hashes;
+	rc = mdb_drop(txn, bloomDbi, 0); // clear the outgrown filter, or anything from a filter with an unknown format
+	if (rc)
+		return rc;
+	bloomBlocks = blockCount;
+	bloomHashes = hashes;
+	rc = buildBloomFilter(txn, dbi);
+	if (rc == 0)
+		rc = writeBloomMeta(txn);
+	if (rc)
+		bloomBlocks = 0;
+	return rc;
+}
+
+#ifdef MDB_OVERLAPPINGSYNC
+int ExtendedEnv::openExtendedDbi(MDB_env* env, MDB_txn* txn, MDB_dbi dbi, const char* name, bool hasVersions,
+		dbi_extensions_t* extensions, ExtendedDbi** extendedDbi) {
+	if (dbi >= extendedDbis.size())
+		return EINVAL;
+	// the extensions are shared by all the threads using this env
+	pthread_mutex_lock(&extendedDbisLock);
+	ExtendedDbi* existing = extendedDbis[dbi];
+	ExtendedDbi* ed = existing ? existing : new ExtendedDbi();
+	ed->hasVersions = hasVersions;
+	std::string dbName(name ? name : "");
+	unsigned int envFlags;
+	mdb_env_get_flags(env, &envFlags);
+	int rc = 0;
+	if (extensions->valueLogThreshold) {
+		if (ed->valueLog) {
+			ed->valueLog->threshold = extensions->valueLogThreshold;
+		} else {
+			const char* envPath;
+			mdb_env_get_path(env, &envPath);
+			std::string path(envPath);
+			path += (envFlags & MDB_NOSUBDIR) ? "-" : "/";
+			std::string fileName(name ? name : "data");
+			for (auto& c : fileName) {
+				if (!isalnum((unsigned char) c) && c != '-' && c != '_')
+					c = '_';
+			}
+			path += fileName + ".vlog";
+			ValueLog* valueLog = new ValueLog(extensions->valueLogThreshold);
+			rc = valueLog->open(path.c_str(), extensions->valueLogMapSize);
+			if (rc)
+				delete valueLog;
+			else
+				ed->valueLog = valueLog;
+		}
+	}
+	if (!rc && extensions->dedupThreshold) {
+		if (!ed->blobDbi) {
+			std::string blobName = "__dedup:" + dbName;
+			rc = mdb_dbi_open(txn, blobName.c_str(), (envFlags & MDB_RDONLY) ? 0 : MDB_CREATE, &ed->blobDbi);
+			if (rc == MDB_NOTFOUND) // read-only and nothing has been deduplicated
+				rc = 0;
+		}
+		ed->dedupThreshold = extensions->dedupThreshold;
+	}
+	if (!rc && extensions->bloomBitsPerKey && !ed->bloomDbi)
+		rc = ed->openBloomFilter(txn, dbi, dbName, !(envFlags & MDB_RDONLY), extensions->bloomBitsPerKey,
+			extensions->bloomExpectedKeys);
+	if (!rc && !extensions->indexes.empty())
+		rc = ed->openIndexes(txn, dbi, extensions->indexes, !(envFlags & MDB_RDONLY));
+	if (!rc && extensions->history) {
+		if (!ed->historyDbi) {
+			std::string historyName = "__history:" + dbName;
+			rc = mdb_dbi_open(txn, historyName.c_str(), (envFlags & MDB_RDONLY) ? 0 : MDB_CREATE, &ed->historyDbi);
+			if (rc == MDB_NOTFOUND) // read-only and nothing has been superseded
+				rc = 0;
+		}
+		ed->historyMaxVersions = extensions->historyMaxVersions;
+		ed->historyMaxAge = extensions->historyMaxAge;
+	}
+	if (!rc && extensions->ttl) {
+		if (!ed->expiryDbi) {
+			std::string expiryName = "__expiry:" + dbName;
+			rc = mdb_dbi_open(txn, expiryName.c_str(), (envFlags & MDB_RDONLY) ? 0 : MDB_CREATE, &ed->expiryDbi);
+			if (rc == MDB_NOTFOUND) // read-only and nothing has been written
+				rc = 0;
+		}
+		ed->ttl = extensions->ttl;
+	}
+	if (rc && !existing)
+		delete ed;
+	else {
+		extendedDbis[dbi] = ed;
+		*extendedDbi = ed;
+	}
+	pthread_mutex_unlock(&extendedDbisLock);
+	return rc;
+}
+
+// sync any appended values before the data of the txns that reference them is synced, this is called by LMDB (as the
+// sync callback) only when a txn is actually synced, so txns that aren't (noSync, or durability of 'none' or 'flush')
+// don't pay for it, and with overlapping sync it happens in the flush after the commit
+int ExtendedEnv::syncValueLogs(MDB_env* env) {
+	ExtendedEnv* extended_env = (ExtendedEnv*) mdb_env_get_userctx(env);
+	if (!extended_env)
+		return 0;
+	for (ExtendedDbi* extendedDbi : extended_env->extendedDbis) {
+		if (extendedDbi && extendedDbi->valueLog) {
+			int rc = extendedDbi->valueLog->sync();
+			if (rc)
+				return rc;
+		}
+	}
+	return 0;
+}
+#endif
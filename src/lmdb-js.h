@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <unordered_map>
+#include <atomic>
+#include <string>
 #include <algorithm>
 #include <ctime>
 #include <napi.h>
@@ -21,6 +23,8 @@ using namespace Napi;
 
 // set the threshold of when to use shared buffers (for uncompressed entries larger than this value)
 const size_t SHARED_BUFFER_THRESHOLD = 0x1000000;
+const uint32_t ZERO_COPY_READ = 0x80000000; // flag on the key size to reference values in the memory map
+const size_t ZERO_COPY_THRESHOLD = 0x1000;
 const uint32_t SPECIAL_WRITE = 0x10101;
 const uint32_t REPLACE_WITH_TIMESTAMP_FLAG = 0x1000000;
 const uint32_t REPLACE_WITH_TIMESTAMP = 0x1010101;
@@ -152,8 +156,14 @@ void consoleLogN(int n);
 void setFlagFromValue(int *flags, int flag, const char *name, bool defaultValue, Object options);
 void writeValueToEntry(const Value &str, MDB_val *val);
 LmdbKeyType keyTypeFromOptions(const Value &val, LmdbKeyType defaultKeyType = LmdbKeyType::DefaultKey);
-int getVersionAndUncompress(MDB_val &data, DbiWrap* dw);
+// with the key and the txn id of its (committed) page, decompressed values can be served from (and added to) the value cache.
+// Returns MDB_CORRUPTED if the value is a reference that can't be resolved
+int getVersionAndUncompress(MDB_val &data, DbiWrap* dw, MDB_txn* txn, MDB_val* key = nullptr, mdb_size_t txnId = 0);
 int compareFast(const MDB_val *a, const MDB_val *b);
+int writeOrderedBinaryNumber(double number, uint8_t* target, bool inSequence);
+bool readOrderedBinaryNumber(const uint8_t* source, int size, double* number);
+// bring the pages of a value into the OS cache, returning what was read from them (so it isn't optimized out)
+int prefetchPages(void* data, size_t size);
 napi_value setGlobalBuffer(napi_env env, napi_callback_info info);
 napi_value lmdbError(napi_env env, napi_callback_info info);
 napi_value createBufferForAddress(napi_env env, napi_callback_info info);
@@ -225,6 +235,7 @@ class WriteWorker {
 	MDB_txn* AcquireTxn(int* flags);
 	void UnlockTxn();
 	int WaitForCallbacks(MDB_txn** txn, bool allowCommit, uint32_t* target);
+	void recordWriteRate(double processed, uint64_t writeStart, uint64_t commitStart);
 	virtual void SendUpdate();
 	int interruptionStatus;
 	bool finishedProgress;
@@ -237,6 +248,11 @@ class WriteWorker {
 	virtual ~WriteWorker();
 	uint32_t* instructions;
 	int progressStatus;
+	// durability levels of the instructions in the current txn: whether any requires an fsync, and whether all allow skipping it
+	bool syncRequested;
+	bool syncOptional;
+	// time spent waiting for instructions or callbacks from JS in the current txn, which isn't counted as writing
+	uint64_t timeWaiting;
 	MDB_env* env;
 	static int DoWrites(MDB_txn* txn, EnvWrap* envForTxn, uint32_t* instruction, WriteWorker* worker);
 	static bool threadSafeCallsEnabled;
@@ -266,16 +282,39 @@ typedef struct env_tracking_t {
 typedef struct buffer_info_t { // definition of a buffer that is available/used in JS
 	int32_t id;
 	bool isSharedMap;
+	char* start;
 	char* end;
 	MDB_env* env;
 	napi_ref ref;
+	// read results buffers are reclaimed once the reading thread has moved on to another buffer (retired), the
+	// results have been delivered to JS, and JS no longer references the buffer (the ArrayBuffers are collected)
+	bool retired;
+	bool released; // the reference to the ArrayBuffer is weak
+	bool resultsEscaped; // JS may still reference results in the buffer (otherwise it can be detached once retired)
+	int32_t pendingResults;
+	int32_t liveArrayBuffers;
+	struct results_array_buffer_t* arrayBuffer;
 } buffer_info_t;
 
+typedef struct results_array_buffer_t { // the finalizer hint for the ArrayBuffer of a read results buffer
+	buffer_info_t* buffer; // null once the ArrayBuffer has been detached and the buffer reclaimed
+} results_array_buffer_t;
+
+const size_t RESULTS_SLAB_SIZE = 0x40000; // 256KB, larger values get their own slab
+const uint32_t READ_RESULT_RELEASED = 0xffffffff; // written to the offset by JS once it has copied the result
+
 typedef struct js_buffers_t { // there is one instance of this for each JS (worker) thread, holding all the active buffers
-	std::unordered_map<char*, buffer_info_t> buffers;
+	std::unordered_map<char*, buffer_info_t> buffers; // by start address
+	std::vector<buffer_info_t*> buffersById; // slots by id, null once removed
+	std::vector<int32_t> freeIds; // ids of reclaimed read results buffers, which JS doesn't cache, to reuse
+	std::vector<char*> freeResultBuffers; // reclaimed read results slabs (of RESULTS_SLAB_SIZE), to reuse
 	int nextId;
 	pthread_mutex_t modification_lock;
 } js_buffers_t;
+// these must be called with the modification_lock held
+int32_t registerBuffer(js_buffers_t* buffers, char* start, buffer_info_t& bufferInfo);
+buffer_info_t* findBuffer(js_buffers_t* buffers, int32_t id);
+void reclaimResultsBuffer(napi_env env, js_buffers_t* buffers, buffer_info_t* buffer);
 
 
 typedef struct callback_holder_t {
@@ -286,12 +325,210 @@ typedef struct user_buffer_t {
 	MDB_val buffer;
 	std::vector<napi_threadsafe_function> callbacks;
 } user_buffer_t;
+const int TAIL_UNKNOWN = 0;
+const int AT_TAIL = 1;
+const int NOT_AT_TAIL = 2;
+typedef struct append_tail_t { // the last key put in a dbi by a write txn, for appending increasing keys
+	mdb_size_t txnId;
+	int state;
+	std::vector<char> lastKey; // at least as large as any key in the dbi, when AT_TAIL
+} append_tail_t;
+// status bytes of the references to externally stored values
+const uint8_t DEDUP_REFERENCE = 252;
+const uint8_t VALUE_LOG_REFERENCE = 253;
+const size_t EXTERNAL_REFERENCE_SIZE = 16;
+/*
+	`ValueLog`
+	An append-only, memory-mapped file that holds the large values of a database outside of the B-tree
+	(key-value separation). The B-tree entry holds a 16-byte reference (status byte, size and offset) to the
+	value in the log, and compaction relocates the live records and punches holes in the reclaimed range.
+*/
+class ValueLog {
+public:
+	ValueLog(unsigned int threshold);
+	~ValueLog();
+	unsigned int threshold;
+	int open(const char* path, mdb_size_t mapSize);
+	// whether the value should be appended to the log rather than stored in the B-tree
+	bool shouldStore(MDB_val& value) {
+		return value.mv_size >= threshold || (value.mv_size == EXTERNAL_REFERENCE_SIZE && *((uint8_t*) value.mv_data) == VALUE_LOG_REFERENCE);
+	}
+	// append the key and value, writing the reference to be stored in the B-tree
+	int append(MDB_val& key, MDB_val& value, char* reference);
+	// resolve a reference from the B-tree to the value in the log, false if it is outside of the log
+	bool resolve(MDB_val& data);
+	int sync();
+	int compact(MDB_txn* txn, MDB_dbi dbi, unsigned int headerSize, mdb_size_t maxBytes, mdb_size_t until,
+		mdb_size_t* position, mdb_size_t* end);
+private:
+	int fd;
+	char* map;
+	mdb_size_t mapSize;
+	std::atomic<mdb_size_t> end; // the known end of the file, references past it are checked against the file size
+	std::atomic<bool> dirty; // appends (under the write lock) can race with the sync of an overlapping flush
+	int readHeader(uint64_t* header);
+	int writeHeader(uint64_t* header);
+};
+
+/*
+	`ValueCache`
+	A cache of decompressed values, shared by all the threads using an env (it is part of the ExtendedEnv). Entries
+	are keyed by dbi and key, and are only used if the txn id of the entry's leaf page (from mdb_get_with_txn) is
+	the same as when the value was cached, so a modified entry is never returned. It is bounded by bytes, evicting
+	with the CLOCK policy, and is split into independently locked shards.
+*/
+typedef struct value_cache_entry_t {
+	std::string key;
+	mdb_size_t txnId;
+	char* data;
+	size_t size;
+	bool referenced;
+	size_t position; // in the clock
+} value_cache_entry_t;
+
+class ValueCache {
+public:
+	ValueCache(size_t maxBytes);
+	~ValueCache();
+	// copy the cached value into the target, if it is there, is still valid, and fits
+	bool get(MDB_dbi dbi, MDB_val& key, mdb_size_t txnId, char* target, size_t targetSize, MDB_val& data);
+	void put(MDB_dbi dbi, MDB_val& key, mdb_size_t txnId, MDB_val& data);
+private:
+	struct shard_t {
+		pthread_mutex_t lock;
+		std::unordered_map<std::string, value_cache_entry_t*> entries;
+		std::vector<value_cache_entry_t*> clock;
+		size_t hand;
+		size_t bytes;
+	};
+	shard_t* shards;
+	size_t maxShardBytes;
+	shard_t* shardFor(std::string& cacheKey);
+	void evict(shard_t* shard, size_t needed);
+	void remove(shard_t* shard, value_cache_entry_t* entry);
+};
+
+typedef struct index_config_t {
+	std::string name;
+	uint32_t offset;
+	uint32_t length;
+} index_config_t;
+
+typedef struct dbi_extensions_t {
+	unsigned int valueLogThreshold;
+	mdb_size_t valueLogMapSize;
+	unsigned int dedupThreshold;
+	unsigned int bloomBitsPerKey;
+	mdb_size_t bloomExpectedKeys;
+	std::vector<index_config_t> indexes{};
+	bool history = false;
+	uint32_t historyMaxVersions = 0;
+	double historyMaxAge = 0;
+	double ttl = 0;
+} dbi_extensions_t;
+
+// a secondary index of the bytes of the values in a fixed range, the index dbi maps them to the primary keys
+typedef struct index_extractor_t {
+	MDB_dbi dbi;
+	uint32_t offset;
+	uint32_t length;
+} index_extractor_t;
+
+/*
+	`ExtendedDbi`
+	The storage extensions of a dbi (value log, deduplication, Bloom filter, secondary indexes, history, expiration),
+	applied in the write path and used on reads.
+	There is one instance for each dbi in an env, shared by all the threads.
+*/
+class ExtendedDbi {
+public:
+	ExtendedDbi();
+	~ExtendedDbi();
+	bool hasVersions;
+	ValueLog* valueLog;
+	// deduplicated values are stored once in the blob dbi, keyed by their hash and with a reference count
+	MDB_dbi blobDbi;
+	unsigned int dedupThreshold;
+	// a blocked Bloom filter of the keys that have been put, stored in its own dbi (so it is updated atomically with
+	// the entries), that lets lookups of missing keys skip the B-tree. There are no filter blocks until it is built.
+	MDB_dbi bloomDbi;
+	uint32_t bloomBlocks;
+	uint32_t bloomHashes;
+	int openBloomFilter(MDB_txn* txn, MDB_dbi dbi, std::string& dbName, bool canWrite, unsigned int bitsPerKey,
+		mdb_size_t expectedKeys);
+	// false if the key is definitely not in the dbi
+	bool mayContain(MDB_txn* txn, MDB_val* key);
+	int bloomStats(MDB_txn* txn, uint32_t* geometry, double* falsePositiveRate);
+	// indexes updated in the same txn as the entries (from the old and new value bytes)
+	std::vector<index_extractor_t> indexes;
+	int openIndexes(MDB_txn* txn, MDB_dbi dbi, std::vector<index_config_t>& configs, bool canWrite);
+	// superseded (and removed) versions of entries, keyed by the key and version, pruned by count and age
+	MDB_dbi historyDbi;
+	uint32_t historyMaxVersions;
+	double historyMaxAge;
+	// the entry (with its version) that was current as of the version, from the dbi or the history
+	int getAsOf(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, double version, MDB_val* data);
+	// entries expire ttl ms after they are written, and are then treated as missing until they are swept. The
+	// expiration is stored in the header (after the version), and the expiry dbi is keyed by [expiration][key]
+	double ttl;
+	MDB_dbi expiryDbi;
+	// the bytes before the value (or reference) in a stored entry
+	unsigned int headerSize() {
+		return (hasVersions ? 8 : 0) + (ttl ? 8 : 0);
+	}
+	bool isExpired(MDB_val& entry);
+	// delete (up to the max number of) expired entries
+	int sweepExpired(MDB_txn* txn, MDB_dbi dbi, unsigned int maxEntries, unsigned int* swept);
+	bool isReference(MDB_val& data) {
+		if (data.mv_size != EXTERNAL_REFERENCE_SIZE)
+			return false;
+		uint8_t type = *((uint8_t*) data.mv_data);
+		return (type == VALUE_LOG_REFERENCE && valueLog) || (type == DEDUP_REFERENCE && blobDbi);
+	}
+	// resolve a reference (after the version) to the stored value
+	bool resolve(MDB_txn* txn, MDB_val& data);
+	int put(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* value, unsigned int flags, bool setVersion, double version);
+	int del(MDB_txn* txn, MDB_dbi dbi, MDB_val* key);
+	int drop(MDB_txn* txn, MDB_dbi dbi, int del);
+private:
+	int storeBlob(MDB_txn* txn, MDB_val& value, char* reference);
+	int releaseBlob(MDB_txn* txn, char* reference);
+	int getExistingReference(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, char* reference);
+	int addToBloomFilter(MDB_txn* txn, MDB_val* key);
+	int readBloomGeometry(MDB_txn* txn, uint32_t* geometry);
+	int getBloomBlock(MDB_txn* txn, MDB_val* key, uint32_t* geometry, uint32_t* block, uint32_t* bits, MDB_val* data);
+	int buildBloomFilter(MDB_txn* txn, MDB_dbi dbi);
+	int writeBloomMeta(MDB_txn* txn);
+	int getIndexKeys(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, std::vector<std::string>& indexKeys);
+	int updateIndexes(MDB_txn* txn, MDB_val* key, std::vector<std::string>& oldIndexKeys, MDB_val* value,
+		size_t first = 0);
+	int getPrevious(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, std::string& previous);
+	int archive(MDB_txn* txn, MDB_val* key, std::string& previous, bool setVersion, double version);
+	int archiveRemoval(MDB_txn* txn, MDB_val* key, std::string& previous);
+	int archiveAll(MDB_txn* txn, MDB_dbi dbi);
+	int pruneHistory(MDB_txn* txn, std::string& prefix, double newestVersion);
+	double getExpiration(MDB_txn* txn, MDB_dbi dbi, MDB_val* key);
+	int updateExpiry(MDB_txn* txn, MDB_val* key, double previousExpiration, double expiration);
+};
+
 class ExtendedEnv {
 public:
-	ExtendedEnv();
+	ExtendedEnv(unsigned int readTxnPoolSize, size_t valueCacheSize);
 	~ExtendedEnv();
-	static MDB_txn* prefetchTxns[20];
-	static pthread_mutex_t* prefetchTxnsLock;
+	// reset read txns for native readers to renew, each thread starts with its own slot so they rarely contend
+	std::atomic<MDB_txn*>* readTxnPool;
+	unsigned int readTxnPoolSize;
+	ValueCache* valueCache; // decompressed values, if enabled
+	// ring of the keys written by each txn, that readers (in any thread) use to invalidate their caches
+	uint32_t* commitFeed;
+	pthread_mutex_t commitFeedLock; // held while writing to the ring (by the writer, or a direct write)
+	// changes recorded by the current write txn (under the write lock), published once it is committed or aborted
+	std::vector<uint32_t> pendingChanges;
+	uint32_t pendingTxnId;
+	bool pendingOverflow;
+	void recordChange(MDB_txn* txn, MDB_dbi dbi, MDB_val* key);
+	void publishEntries(uint32_t* entries, uint32_t count);
+	void publishChanges(uint32_t lastTxnId, bool committed);
 	std::unordered_map<std::string, callback_holder_t> lockCallbacks;
 	std::unordered_map<std::string, user_buffer_t> userSharedBuffers;
 	pthread_mutex_t locksModificationLock;
@@ -307,6 +544,16 @@ public:
 	static MDB_txn* getPrefetchReadTxn(MDB_env* env);
 	static void donePrefetchReadTxn(MDB_txn* txn);
 	static void removeReadTxns(MDB_env* env);
+	// storage extensions, indexed by dbi
+	std::vector<ExtendedDbi*> extendedDbis;
+	pthread_mutex_t extendedDbisLock;
+	int openExtendedDbi(MDB_env* env, MDB_txn* txn, MDB_dbi dbi, const char* name, bool hasVersions,
+		dbi_extensions_t* extensions, ExtendedDbi** extendedDbi);
+	ExtendedDbi* getExtendedDbi(MDB_dbi dbi) {
+		return dbi < extendedDbis.size() ? extendedDbis[dbi] : nullptr;
+	}
+	static int syncValueLogs(MDB_env* env);
+	static void publishChanges(MDB_env* env, bool committed);
 };
 
 class EnvWrap : public ObjectWrap<EnvWrap> {
@@ -348,6 +595,11 @@ public:
 	bool readTxnRenewed;
     bool hasWrites;
 	uint64_t timeTxnWaiting;
+	// the writer's progress, shared with JS for backpressure: the number of instructions processed, and the rate
+	// (instructions per ms while writing) and time per commit (ms, including any sync) smoothed over recent txns
+	double writeQueueStats[3];
+	std::vector<append_tail_t> appendTails;
+	append_tail_t* getAppendTail(MDB_txn* txn, MDB_dbi dbi);
 	unsigned int jsFlags;
 	char* keyBuffer;
 	int pageSize;
@@ -358,7 +610,8 @@ public:
 	static void setupExports(Napi::Env env, Object exports);
 	void closeEnv(bool hasLock = false);
 	int openEnv(int flags, int jsFlags, const char* path, char* keyBuffer, Compression* compression, int maxDbs,
-		int maxReaders, mdb_size_t mapSize, int pageSize, unsigned int max_free_to_load, unsigned int max_free_to_retain, char* encryptionKey);
+		int maxReaders, int readTxnPoolSize, size_t valueCacheSize, mdb_size_t mapSize, int pageSize, unsigned int max_free_to_load,
+		unsigned int max_free_to_retain, char* encryptionKey);
 	
 	/*
 		Gets statistics about the database environment.
@@ -435,6 +688,14 @@ public:
 	Napi::Value commitTxn(const CallbackInfo& info);
 	Napi::Value abortTxn(const CallbackInfo& info);
 	Napi::Value getWriteTxnId(const CallbackInfo& info);
+	/*
+		Sets how full (in percent) pages are filled by appends in the current write transaction.
+
+		Parameters:
+
+		* Fill percentage (10 to 100)
+	*/
+	Napi::Value setWriteFill(const CallbackInfo& info);
 
 	/*
 		Flushes all data to the disk asynchronously.
@@ -551,6 +812,12 @@ public:
 	bool hasVersions;
 	// current unsafe buffer for this db
 	bool getFast;
+	// storage extensions (value log, deduplication), if enabled
+	ExtendedDbi* extendedDbi;
+	ValueCache* valueCache;
+	// leaf pages to read ahead of forward cursor scans (0 if disabled), and the page size for detecting leaf changes
+	unsigned int scanReadAhead;
+	unsigned int pageSize;
 
 	friend class TxnWrap;
 	friend class CursorWrap;
@@ -581,7 +848,11 @@ public:
 
 	Napi::Value stat(const CallbackInfo& info);
 	int prefetch(uint32_t* keys);
-	int open(int flags, char* name, bool hasVersions, LmdbKeyType keyType, Compression* compression);
+	int prefetchRange(uint32_t* keys, mdb_size_t maxBytes);
+	int open(int flags, char* name, bool hasVersions, LmdbKeyType keyType, Compression* compression,
+		dbi_extensions_t* extensions = nullptr);
+	Napi::Value compactValueLog(const CallbackInfo& info);
+	Napi::Value sweepExpired(const CallbackInfo& info);
 	int32_t doGetByBinary(uint32_t keySize, uint32_t ifNotTxnId, int64_t txnAddress);
 	static void setupExports(Napi::Env env, Object exports);
 };
@@ -657,8 +928,13 @@ public:
 	*/
 	Napi::Value del(const CallbackInfo& info);
 
+	// leaf page the cursor is on, how many it has moved through, and how far ahead has been read
+	size_t lastLeafPage;
+	unsigned int leafPagesScanned;
+	unsigned int readAhead;
 	int returnEntry(int lastRC, MDB_val &key, MDB_val &data);
 	int32_t doPosition(uint32_t offset, uint32_t keySize, uint64_t endKeyAddress);
+	void trackScan(MDB_val &key);
 	//Value getStringByBinary(const CallbackInfo& info);
 };
 
@@ -4,9 +4,40 @@
 #include <stdio.h>
 #include <node_version.h>
 #include <time.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 using namespace Napi;
 
+// values spanning more pages than this are read in by the kernel as one run, rather than one fault at a time
+const size_t PREFETCH_ADVISE_THRESHOLD = 0x4000;
+
+int prefetchPages(void* data, size_t size) {
+	uint8_t* start = (uint8_t*) data;
+	int effected = 0;
+#ifndef _WIN32
+	if (size > PREFETCH_ADVISE_THRESHOLD) {
+		static size_t pageSize = sysconf(_SC_PAGESIZE);
+		size_t alignedStart = (size_t) start & ~(pageSize - 1);
+		size_t length = (size_t) start + size - alignedStart;
+#ifdef MADV_POPULATE_READ
+		// faults in the whole range (batching the I/O) and returns once it is resident
+		if (madvise((void*) alignedStart, length, MADV_POPULATE_READ) == 0)
+			return *start;
+#endif
+		// start readahead of the whole range, so the accesses below wait on I/O that is already in flight
+		madvise((void*) alignedStart, length, MADV_WILLNEED);
+	}
+#endif
+	// access one byte from each of the pages to ensure they are in the OS cache,
+	// potentially triggering the hard page fault in this thread
+	for (size_t offset = 0; offset < size; offset += 0x1000)
+		effected += start[offset];
+	return effected;
+}
+
 static thread_local char* globalUnsafePtr;
 static thread_local size_t globalUnsafeSize;
 
@@ -100,7 +131,7 @@ Value valToBinaryUnsafe(MDB_val &data, DbiWrap* dw, Env env) {
 }
 
 
-int getVersionAndUncompress(MDB_val &data, DbiWrap* dw) {
+int getVersionAndUncompress(MDB_val &data, DbiWrap* dw, MDB_txn* txn, MDB_val* key, mdb_size_t txnId) {
 	//fprintf(stdout, "uncompressing %u\n", compressionThreshold);
 	unsigned char* charData = (unsigned char*) data.mv_data;
 	if (dw->hasVersions) {
@@ -110,6 +141,18 @@ int getVersionAndUncompress(MDB_val &data, DbiWrap* dw) {
 		data.mv_data = charData;
 		data.mv_size -= 8;
 	}
+	if (dw->extendedDbi && dw->extendedDbi->ttl && data.mv_size >= 8) {
+		// skip the expiration (the callers check if the entry has expired)
+		charData = charData + 8;
+		data.mv_data = charData;
+		data.mv_size -= 8;
+	}
+	if (dw->extendedDbi && dw->extendedDbi->isReference(data)) {
+		// reference to a value in the value log or blob dbi
+		if (!dw->extendedDbi->resolve(txn, data))
+			return MDB_CORRUPTED;
+		charData = (unsigned char*) data.mv_data;
+	}
 	if (data.mv_size == 0) {
 		return 1;// successFunc(data);
 	}
@@ -118,8 +161,13 @@ int getVersionAndUncompress(MDB_val &data, DbiWrap* dw) {
 		//fprintf(stdout, "uncompressing status %X\n", statusByte);
 	if (statusByte >= 250) {
 		bool isValid;
-
+		bool cacheable = key && txnId && dw->valueCache;
+		if (cacheable && dw->valueCache->get(dw->dbi, *key, txnId, dw->compression->decompressTarget,
+				dw->compression->decompressSize, data))
+			return data.mv_size <= dw->compression->decompressSize ? 2 : 0;
 		dw->compression->decompress(data, isValid, !dw->getFast);
+		if (isValid && cacheable)
+			dw->valueCache->put(dw->dbi, *key, txnId, data);
 		return isValid ? 2 : 0;
 	}
 	return 1;
@@ -213,13 +261,8 @@ class ReadWorker : public AsyncWorker {
 			*((double*)gets) = (double) (size_t) data.mv_data;
 			gets += (key.mv_size + 28) >> 2;
 			while (!rc) {
-				// access one byte from each of the pages to ensure they are in the OS cache,
-				// potentially triggering the hard page fault in this thread
-				int pages = (data.mv_size + 0xfff) >> 12;
-				// TODO: Adjust this for the page headers, I believe that makes the first page slightly less 4KB.
-				for (int i = 0; i < pages; i++) {
-					effected += *(((uint8_t*)data.mv_data) + (i << 12));
-				}
+				// bring the pages of the value into the OS cache (in this thread)
+				effected += prefetchPages(data.mv_data, data.mv_size);
 				if (dupSort) // in dupsort databases, access the rest of the values
 					rc = mdb_cursor_get(cursor, &key, &data, MDB_NEXT_DUP);
 				else
@@ -255,48 +298,38 @@ typedef struct {
 } read_callback_t;
 static int next_buffer_id = -1;
 typedef struct {
+	int32_t resultBufferId; // the read results buffer the value was copied to
+	int32_t retiredBufferId; // the read results buffer this read moved on from
+} read_result_t;
+typedef struct { // a batch of consecutive read instructions, recorded in one event-loop turn
 	uint32_t* instructionAddress;
+	uint32_t count;
 	uint32_t callback_id;
 	napi_async_work work;
 	//napi_deferred deferred;
 	js_buffers_t* buffers;
-} read_instruction_t;
+	std::vector<uint32_t*> instructions;
+	std::vector<read_result_t> results;
+} read_batch_t;
 const uint32_t ZERO = 0;
-void do_read(napi_env nenv, void* instruction_pointer) {
-	read_instruction_t* readInstruction = (read_instruction_t*) instruction_pointer;
-	//fprintf(stderr, "lock %p\n", &readInstruction->buffers->modification_lock);
-	uint32_t* instruction = readInstruction->instructionAddress;
+static void read_instruction(read_batch_t* batch, uint32_t* instruction, MDB_cursor* cursor, read_result_t* result) {
 	MDB_val key;
 	key.mv_size = *(instruction + 3);
-	MDB_dbi dbi = (MDB_dbi) (*(instruction + 2) & 0xffff) ;
+	key.mv_data = (void*) (instruction + 4);
 	MDB_val data;
-	TxnWrap* tw = (TxnWrap*) (size_t) *((double*)instruction);
-	MDB_txn* txn = tw->txn;
-	mdb_txn_renew(txn);
+	data.mv_size = 0;
+	MDB_txn* txn = mdb_cursor_txn(cursor);
 	unsigned int flags;
-	mdb_dbi_flags(txn, dbi, &flags);
+	mdb_dbi_flags(txn, mdb_cursor_dbi(cursor), &flags);
 	bool dupSort = flags & MDB_DUPSORT;
 	int effected = 0;
-	MDB_cursor *cursor;
 	MDB_env* env = mdb_txn_env(txn);
-	int rc = mdb_cursor_open(txn, dbi, &cursor);
-	if (rc) {
-		*instruction = rc;
-		return;
-	}
-	key.mv_data = (void*) (instruction + 4);
-	rc = mdb_cursor_get(cursor, &key, &data, MDB_SET_KEY);
+	int rc = mdb_cursor_get(cursor, &key, &data, MDB_SET_KEY);
 	*(instruction + 3) = data.mv_size;
 
-	//instruction += (key.mv_size + 28) >> 2;
 	while (!rc) {
-		// access one byte from each of the pages to ensure they are in the OS cache,
-		// potentially triggering the hard page fault in this thread
-		int pages = (data.mv_size + 0xfff) >> 12;
-		// TODO: Adjust this for the page headers, I believe that makes the first page slightly less than 4KB.
-		for (int i = 0; i < pages; i++) {
-			effected += *(((uint8_t*)data.mv_data) + (i << 12));
-		}
+		// bring the pages of the value into the OS cache (in this thread)
+		effected += prefetchPages(data.mv_data, data.mv_size);
 		if (dupSort) // in dupsort databases, access the rest of the values
 			rc = mdb_cursor_get(cursor, &key, &data, MDB_NEXT_DUP);
 		else
@@ -317,52 +350,142 @@ void do_read(napi_env nenv, void* instruction_pointer) {
 		if (!buffersByWorker)
 			buffersByWorker = new std::unordered_map<void*, read_results_buffer_t*>;
 		read_results_buffer_t* read_buffer;
-		auto buffer_search = buffersByWorker->find(readInstruction->buffers);
+		auto buffer_search = buffersByWorker->find(batch->buffers);
 		if (buffer_search == buffersByWorker->end()) {
 			// create new one
-			buffersByWorker->emplace(readInstruction->buffers, read_buffer = new read_results_buffer_t);
+			buffersByWorker->emplace(batch->buffers, read_buffer = new read_results_buffer_t);
 			read_buffer->size = 0;
 			read_buffer->offset = 0; // force it re-malloc
 		} else
 			read_buffer = buffer_search->second;
-		if ((int) read_buffer->size - (int) read_buffer->offset - 4 < (int) data.mv_size) {
-			size_t size = 0x40000;// 256KB
-			read_buffer->data = (char*) malloc(size);
-			read_buffer->size = size;
+		js_buffers_t* buffers = batch->buffers;
+		pthread_mutex_lock(&buffers->modification_lock);
+		read_results_buffer_t* target = read_buffer;
+		read_results_buffer_t large_buffer;
+		if (data.mv_size + 8 > RESULTS_SLAB_SIZE) {
+			// too big for a slab, so it gets a dedicated buffer, that is retired as soon as its result is delivered
+			target = &large_buffer;
+			large_buffer.size = (data.mv_size + 0x1007) & ~0xfff;
+			large_buffer.offset = 0;
+			large_buffer.data = (char*) malloc(large_buffer.size);
+			buffer_info_t buffer_info;
+			buffer_info.end = large_buffer.data + large_buffer.size;
+			buffer_info.env = nullptr;
+			buffer_info.isSharedMap = false;
+			large_buffer.id = registerBuffer(buffers, large_buffer.data, buffer_info);
+			findBuffer(buffers, large_buffer.id)->retired = true;
+		} else if ((int) read_buffer->size - (int) read_buffer->offset - 4 < (int) data.mv_size) {
+			if (read_buffer->size) {
+				// retire the current buffer, it can be reclaimed (by the JS thread) once its results are consumed
+				buffer_info_t* retired = findBuffer(buffers, read_buffer->id);
+				if (retired)
+					retired->retired = true;
+				result->retiredBufferId = read_buffer->id;
+			}
+			// slabs are recycled through the pool of this JS thread
+			if (buffers->freeResultBuffers.empty())
+				read_buffer->data = (char*) malloc(RESULTS_SLAB_SIZE);
+			else {
+				read_buffer->data = buffers->freeResultBuffers.back();
+				buffers->freeResultBuffers.pop_back();
+			}
+			read_buffer->size = RESULTS_SLAB_SIZE;
 			read_buffer->offset = 0;
 			buffer_info_t buffer_info;
-			buffer_info.end = read_buffer->data + size;
+			buffer_info.end = read_buffer->data + RESULTS_SLAB_SIZE;
 			buffer_info.env = nullptr;
 			buffer_info.isSharedMap = false;
-			pthread_mutex_lock(&readInstruction->buffers->modification_lock);
-			buffer_info.id = read_buffer->id = readInstruction->buffers->nextId++;
-			readInstruction->buffers->buffers.emplace(read_buffer->data, buffer_info);
-			pthread_mutex_unlock(&readInstruction->buffers->modification_lock);
-
+			read_buffer->id = registerBuffer(buffers, read_buffer->data, buffer_info);
 		}
-		auto position = (uint32_t*) (read_buffer->data + read_buffer->offset);
+		findBuffer(buffers, target->id)->pendingResults++;
+		result->resultBufferId = target->id;
+		pthread_mutex_unlock(&buffers->modification_lock);
+		auto position = (uint32_t*) (target->data + target->offset);
 		memcpy(position, data.mv_data, data.mv_size);
 		position += (data.mv_size + 7) >> 2;
-		*(instruction + 1) = read_buffer->id;
-		*(instruction + 2) = read_buffer->offset;
-		read_buffer->offset = (char*)position - read_buffer->data;
+		*(instruction + 1) = target->id;
+		*(instruction + 2) = target->offset;
+		target->offset = (char*)position - target->data;
+	}
+}
+
+/*
+	Reads each instruction in the batch, reusing the renewed txn and the cursor across consecutive instructions for
+	the same txn and dbi
+*/
+void do_read(napi_env nenv, void* batch_pointer) {
+	read_batch_t* batch = (read_batch_t*) batch_pointer;
+	batch->instructions.resize(batch->count);
+	batch->results.resize(batch->count);
+	uint32_t* instruction = batch->instructionAddress;
+	TxnWrap* lastTxn = nullptr;
+	MDB_cursor* cursor = nullptr;
+	MDB_dbi cursorDbi = 0;
+	for (uint32_t i = 0; i < batch->count; i++) {
+		read_result_t* result = &batch->results[i];
+		result->resultBufferId = -1;
+		result->retiredBufferId = -1;
+		batch->instructions[i] = instruction;
+		// instructions are 4-byte aligned: [txn address: 8][dbi: 4][key size: 4][key]
+		uint32_t* next = instruction + ((*(instruction + 3) + 28) >> 2);
+		TxnWrap* tw = (TxnWrap*) (size_t) *((double*)instruction);
+		MDB_dbi dbi = (MDB_dbi) (*(instruction + 2) & 0xffff);
+		if (tw != lastTxn || dbi != cursorDbi) {
+			if (cursor) {
+				mdb_cursor_close(cursor);
+				cursor = nullptr;
+			}
+			if (tw != lastTxn)
+				mdb_txn_renew(tw->txn);
+			lastTxn = tw;
+			cursorDbi = dbi;
+			int rc = mdb_cursor_open(tw->txn, dbi, &cursor);
+			if (rc) {
+				cursor = nullptr;
+				lastTxn = nullptr;
+				*instruction = rc;
+				instruction = next;
+				continue;
+			}
+		}
+		read_instruction(batch, instruction, cursor, result);
+		instruction = next;
 	}
-	mdb_cursor_close(cursor);
-	//fprintf(stderr, "unlock %p\n", &readInstruction->buffers->modification_lock);
+	if (cursor)
+		mdb_cursor_close(cursor);
 }
 static thread_local napi_ref* read_callback;
 void read_complete(napi_env env, napi_status status, void* data) {
-	read_instruction_t* readInstruction = (read_instruction_t*) data;
+	read_batch_t* batch = (read_batch_t*) data;
 	napi_value callback;
 	napi_get_reference_value(env, *read_callback, &callback);
 	//uint32_t count;
 	napi_value result;
 	napi_value callback_id;
-	napi_create_int32(env, readInstruction->callback_id, &callback_id);
+	napi_create_int32(env, batch->callback_id, &callback_id);
+	// one callback delivers all the results of the batch
 	status = napi_call_function(env, callback, callback, 1, &callback_id, &result);
-	napi_delete_async_work(env, readInstruction->work);
-	delete readInstruction;
-	//napi_resolve_deferred(env, readInstruction->deferred, resolution);
+	js_buffers_t* buffers = batch->buffers;
+	pthread_mutex_lock(&buffers->modification_lock);
+	for (uint32_t i = 0; i < batch->results.size(); i++) {
+		read_result_t* readResult = &batch->results[i];
+		// the result has been delivered, see if the buffers can be reclaimed
+		buffer_info_t* buffer = findBuffer(buffers, readResult->resultBufferId);
+		if (buffer) {
+			buffer->pendingResults--;
+			// JS marks the results it has copied out, otherwise the buffer has to wait for GC
+			if (*(batch->instructions[i] + 2) != READ_RESULT_RELEASED)
+				buffer->resultsEscaped = true;
+			reclaimResultsBuffer(env, buffers, buffer);
+		}
+		buffer = findBuffer(buffers, readResult->retiredBufferId);
+		if (buffer)
+			reclaimResultsBuffer(env, buffers, buffer);
+	}
+	pthread_mutex_unlock(&buffers->modification_lock);
+	napi_delete_async_work(env, batch->work);
+	delete batch;
+	//napi_resolve_deferred(env, batch->deferred, resolution);
 }
 NAPI_FUNCTION(enableThreadSafeCalls) {
 	WriteWorker::threadSafeCallsEnabled = true;
@@ -377,19 +500,18 @@ NAPI_FUNCTION(setReadCallback) {
 	RETURN_UNDEFINED;
 }
 NAPI_FUNCTION(startRead) {
-	ARGS(4)
+	ARGS(5)
 	GET_INT64_ARG(0);
-	uint32_t* instructionAddress = (uint32_t*) i64;
-	read_instruction_t* readInstruction = new read_instruction_t;
-	readInstruction->instructionAddress = instructionAddress;
+	read_batch_t* batch = new read_batch_t;
+	batch->instructionAddress = (uint32_t*) i64;
+	GET_UINT32_ARG(batch->count, 1);
 	uint32_t callback_id;
-	GET_UINT32_ARG(callback_id, 1);
-	//napi_create_reference(env, args[1], 1, &readInstruction->callback);
-	readInstruction->callback_id = callback_id;
-	readInstruction->buffers = EnvWrap::sharedBuffers;
+	GET_UINT32_ARG(callback_id, 2);
+	batch->callback_id = callback_id;
+	batch->buffers = EnvWrap::sharedBuffers;
 	napi_status status;
-	status = napi_create_async_work(env, args[2], args[3], do_read, read_complete, readInstruction, &readInstruction->work);
-	status = napi_queue_async_work(env, readInstruction->work);
+	status = napi_create_async_work(env, args[3], args[4], do_read, read_complete, batch, &batch->work);
+	status = napi_queue_async_work(env, batch->work);
 	RETURN_UNDEFINED;
 }/*
 NAPI_FUNCTION(nextRead) {
@@ -1,4 +1,5 @@
 #include "lmdb-js.h"
+#include <string.h>
 
 #ifdef _WIN32
 #define ntohl _byteswap_ulong
@@ -44,3 +45,46 @@ int compareFast(const MDB_val *a, const MDB_val *b) {
     }
     return a->mv_size - b->mv_size;
 }
+
+// ordered-binary encoding of a non-negative number: the float64 bits (big-endian) shifted
+// four bits behind a 0x1 type nibble, so the first byte is in the 16-23 range. Trailing
+// zero bytes are trimmed, except in a sequence (array), where numbers are always 9 bytes.
+// Negative numbers (and -0/NaN) are left to the JS encoder
+int writeOrderedBinaryNumber(double number, uint8_t* target, bool inSequence) {
+    uint64_t bits;
+    memcpy(&bits, &number, 8);
+    uint32_t highInt = (uint32_t) (bits >> 32);
+    uint32_t lowInt = (uint32_t) bits;
+    int length;
+    if ((lowInt & 0xf) || inSequence)
+        length = 9;
+    else if (lowInt & 0xfffff)
+        length = 8;
+    else if (lowInt || (highInt & 0xf))
+        length = 6;
+    else
+        length = 4;
+    uint32_t word = htonl((highInt >> 4) | 0x10000000);
+    memcpy(target, &word, 4);
+    word = htonl((lowInt >> 4) | (highInt << 28));
+    memcpy(target + 4, &word, 4);
+    target[8] = (uint8_t) (lowInt << 4);
+    return length;
+}
+
+// decode a non-negative number written by writeOrderedBinaryNumber, returns false if
+// this isn't a number encoding that we handle
+bool readOrderedBinaryNumber(const uint8_t* source, int size, double* number) {
+    if (size > 9 || size < 4 || source[0] < 16 || source[0] >= 24)
+        return false;
+    uint8_t bytes[12] = { 0 };
+    memcpy(bytes, source, size);
+    uint32_t word0, word1;
+    memcpy(&word0, bytes, 4);
+    memcpy(&word1, bytes + 4, 4);
+    word0 = ntohl(word0);
+    word1 = ntohl(word1);
+    uint64_t bits = ((uint64_t) ((word0 << 4) | (word1 >> 28)) << 32) | (uint32_t) ((word1 << 4) | (bytes[8] >> 4));
+    memcpy(number, &bits, 8);
+    return true;
+}
@@ -2,6 +2,7 @@
 #if ENABLE_V8_API
 #include <string.h>
 #include <stdio.h>
+#include <cmath>
 #include <v8.h>
 #include <node.h>
 
@@ -102,6 +103,148 @@ void resetTxnV8(const FunctionCallbackInfo<v8::Value>& info) {
 	tw->reset();
 }
 
+// Native ordered-binary key encoding/decoding for the common key shapes (see keys.js, which
+// verifies these against the JS encoder on startup and enables each shape that matches).
+// These return -1 (or undefined for reads) for anything else, to fall back to the JS encoder.
+const int KEY_STRINGS = 1;
+const int KEY_NUMBERS = 2;
+const int KEY_ARRAYS = 4;
+int writeKeyElement(Isolate* isolate, Local<v8::Value> key, uint8_t* target, int limit, int shapes, bool inSequence) {
+	if (key->IsString()) {
+		if (!(shapes & KEY_STRINGS))
+			return -1;
+		Local<v8::String> string = Local<v8::String>::Cast(key);
+		int length = string->Length();
+		if (length == 0)
+			return -1; // empty strings are escaped
+		int written = 0;
+		int size = string->WriteUtf8(isolate, (char*) target, limit, &written, v8::String::NO_NULL_TERMINATION);
+		if (written < length)
+			return -1; // didn't fit
+		for (int i = 0; i < size; i++) {
+			uint8_t byte = target[i];
+			// control characters are escaped, and lone surrogates are encoded differently, leave these to JS
+			if (byte < 28 || (byte == 0xed && i + 1 < size && target[i + 1] >= 0xa0))
+				return -1;
+		}
+		return size;
+	}
+	if (key->IsNumber()) {
+		if (!(shapes & KEY_NUMBERS) || limit < 9)
+			return -1;
+		double number = Local<v8::Number>::Cast(key)->Value();
+		if (!(number > 0 || (number == 0 && !std::signbit(number))))
+			return -1;
+		return writeOrderedBinaryNumber(number, target, inSequence);
+	}
+	if (key->IsArray() && !inSequence) {
+		if (!(shapes & KEY_ARRAYS))
+			return -1;
+		Local<v8::Array> array = Local<v8::Array>::Cast(key);
+		auto context = isolate->GetCurrentContext();
+		int position = 0;
+		for (uint32_t i = 0, l = array->Length(); i < l; i++) {
+			if (i > 0) {
+				if (position >= limit)
+					return -1;
+				target[position++] = 0; // separator
+			}
+			Local<v8::Value> element;
+			if (!array->Get(context, i).ToLocal(&element))
+				return -1;
+			int size = writeKeyElement(isolate, element, target + position, limit - position, shapes, true);
+			if (size < 0)
+				return -1;
+			position += size;
+		}
+		return position;
+	}
+	return -1;
+}
+int32_t writeNumberKeyFast(Local<v8::Object> instance, double key, double targetAddress, uint32_t limit) {
+	if (!(key > 0 || (key == 0 && !std::signbit(key))) || limit < 13)
+		return -1;
+	uint8_t* target = (uint8_t*) (size_t) targetAddress;
+	int length = writeOrderedBinaryNumber(key, target, false);
+	memset(target + length, 0, 4);
+	return length;
+}
+void writeNumberKeyV8(const FunctionCallbackInfo<v8::Value>& info) {
+	Isolate* isolate = Isolate::GetCurrent();
+	auto context = isolate->GetCurrentContext();
+	info.GetReturnValue().Set(v8::Number::New(isolate, writeNumberKeyFast(Local<v8::Object>(),
+		info[0]->NumberValue(context).FromJust(),
+		info[1]->NumberValue(context).FromJust(),
+		info[2]->Uint32Value(context).FromJust())));
+}
+void writeKeyV8(const FunctionCallbackInfo<v8::Value>& info) {
+	Isolate* isolate = Isolate::GetCurrent();
+	auto context = isolate->GetCurrentContext();
+	uint8_t* target = (uint8_t*) (size_t) info[1]->NumberValue(context).FromJust();
+	int limit = info[2]->Int32Value(context).FromJust() - 4; // reserve room for null termination
+	int shapes = info[3]->Int32Value(context).FromJust();
+	int length = limit > 0 ? writeKeyElement(isolate, info[0], target, limit, shapes, false) : -1;
+	if (length > 0)
+		memset(target + length, 0, 4); // null terminate, for the sake of compareFast
+	info.GetReturnValue().Set(v8::Number::New(isolate, length));
+}
+bool readKeyElement(Isolate* isolate, const uint8_t* source, int size, int shapes, Local<v8::Value>* value) {
+	if (source[0] >= 28) {
+		if (!(shapes & KEY_STRINGS))
+			return false;
+		for (int i = 0; i < size; i++) {
+			if (source[i] < 28 || (source[i] == 0xed && i + 1 < size && source[i + 1] >= 0xa0))
+				return false;
+		}
+		Local<v8::String> string;
+		if (!v8::String::NewFromUtf8(isolate, (const char*) source, NewStringType::kNormal, size).ToLocal(&string))
+			return false;
+		*value = string;
+		return true;
+	}
+	double number;
+	if ((shapes & KEY_NUMBERS) && readOrderedBinaryNumber(source, size, &number)) {
+		*value = v8::Number::New(isolate, number);
+		return true;
+	}
+	return false;
+}
+void readKeyV8(const FunctionCallbackInfo<v8::Value>& info) {
+	Isolate* isolate = Isolate::GetCurrent();
+	auto context = isolate->GetCurrentContext();
+	const uint8_t* source = (const uint8_t*) (size_t) info[0]->NumberValue(context).FromJust();
+	int size = info[1]->Int32Value(context).FromJust();
+	int shapes = info[2]->Int32Value(context).FromJust();
+	if (size <= 0)
+		return; // undefined, use the JS decoder
+	// find the parts of a sequence (elements separated by zeros), numbers are always 9 bytes in a sequence
+	int position = 0;
+	std::vector<Local<v8::Value>> elements;
+	while (position < size) {
+		int end;
+		if (source[position] >= 16 && source[position] < 24) // a number, which can include zero bytes
+			end = size - position > 9 ? position + 9 : size;
+		else {
+			end = position;
+			while (end < size && source[end])
+				end++;
+		}
+		if (end < size && (source[end] || !(shapes & KEY_ARRAYS)))
+			return;
+		Local<v8::Value> element;
+		if (!readKeyElement(isolate, source + position, end - position, shapes, &element))
+			return;
+		elements.push_back(element);
+		if (end < size && end + 1 == size)
+			return; // trailing separator
+		position = end + 1;
+	}
+	if (elements.size() == 1)
+		info.GetReturnValue().Set(elements[0]);
+	else
+		info.GetReturnValue().Set(v8::Array::New(isolate, elements.data(), elements.size()));
+}
+
 void noopFast(Local<v8::Object> instance) {
 }
 
@@ -153,6 +296,7 @@ NAPI_FUNCTION(enableDirectV8) {
 		EXPORT_FAST("write", writeV8, writeFast);
 		EXPORT_FAST("resetTxn", resetTxnV8, resetTxnFast);
 		EXPORT_FAST("noop", noopV8, noopFast);
+		EXPORT_FAST("encodeNumberKey", writeNumberKeyV8, writeNumberKeyFast);
 	} else {
 	#endif
 	EXPORT_FUNCTION("getByBinary", getByBinaryV8);
@@ -160,9 +304,12 @@ NAPI_FUNCTION(enableDirectV8) {
 	EXPORT_FUNCTION("iterate", iterateV8);
 	EXPORT_FUNCTION("write", writeV8);
 	EXPORT_FUNCTION("noop", noopV8);
+	EXPORT_FUNCTION("encodeNumberKey", writeNumberKeyV8);
 	#if NODE_VERSION_AT_LEAST(16,6,1)
 	}
 	#endif
+	EXPORT_FUNCTION("encodeKey", writeKeyV8);
+	EXPORT_FUNCTION("decodeKey", readKeyV8);
 	EXPORT_FUNCTION("clearKeptObjects", clearKeptObjects);
 	EXPORT_FUNCTION("detachBuffer", detachBuffer);
 	#endif
@@ -0,0 +1,127 @@
+#include "lmdb-js.h"
+#include <string.h>
+
+using namespace Napi;
+
+const int VALUE_CACHE_SHARDS = 16;
+// values that would take up more than this fraction of a shard aren't cached, they would just churn the cache
+const int MAX_VALUE_FRACTION = 8;
+// approximate overhead of an entry (the entry, the map node and the clock slot), counted against the budget
+const size_t ENTRY_OVERHEAD = 96;
+
+ValueCache::ValueCache(size_t maxBytes) {
+	shards = new shard_t[VALUE_CACHE_SHARDS];
+	maxShardBytes = maxBytes / VALUE_CACHE_SHARDS;
+	for (int i = 0; i < VALUE_CACHE_SHARDS; i++) {
+		pthread_mutex_init(&shards[i].lock, nullptr);
+		shards[i].hand = 0;
+		shards[i].bytes = 0;
+	}
+}
+
+ValueCache::~ValueCache() {
+	for (int i = 0; i < VALUE_CACHE_SHARDS; i++) {
+		for (value_cache_entry_t* entry : shards[i].clock) {
+			delete[] entry->data;
+			delete entry;
+		}
+		pthread_mutex_destroy(&shards[i].lock);
+	}
+	delete[] shards;
+}
+
+static std::string cacheKeyFor(MDB_dbi dbi, MDB_val& key) {
+	std::string cacheKey((char*) &dbi, sizeof(MDB_dbi));
+	cacheKey.append((char*) key.mv_data, key.mv_size);
+	return cacheKey;
+}
+
+ValueCache::shard_t* ValueCache::shardFor(std::string& cacheKey) {
+	return &shards[std::hash<std::string>{}(cacheKey) % VALUE_CACHE_SHARDS];
+}
+
+bool ValueCache::get(MDB_dbi dbi, MDB_val& key, mdb_size_t txnId, char* target, size_t targetSize, MDB_val& data) {
+	std::string cacheKey = cacheKeyFor(dbi, key);
+	shard_t* shard = shardFor(cacheKey);
+	pthread_mutex_lock(&shard->lock);
+	auto found = shard->entries.find(cacheKey);
+	if (found == shard->entries.end()) {
+		pthread_mutex_unlock(&shard->lock);
+		return false;
+	}
+	value_cache_entry_t* entry = found->second;
+	if (entry->txnId != txnId) {
+		// the entry (or at least its page) has been modified since it was cached
+		remove(shard, entry);
+		pthread_mutex_unlock(&shard->lock);
+		return false;
+	}
+	entry->referenced = true;
+	data.mv_data = target;
+	data.mv_size = entry->size;
+	// if it doesn't fit, the size is still returned, so the caller can expand its buffer and retry
+	if (entry->size <= targetSize)
+		memcpy(target, entry->data, entry->size);
+	pthread_mutex_unlock(&shard->lock);
+	return true;
+}
+
+void ValueCache::put(MDB_dbi dbi, MDB_val& key, mdb_size_t txnId, MDB_val& data) {
+	size_t size = data.mv_size + key.mv_size + ENTRY_OVERHEAD;
+	if (size > maxShardBytes / MAX_VALUE_FRACTION)
+		return;
+	std::string cacheKey = cacheKeyFor(dbi, key);
+	shard_t* shard = shardFor(cacheKey);
+	// copy outside of the lock
+	char* bytes = new char[data.mv_size];
+	memcpy(bytes, data.mv_data, data.mv_size);
+	pthread_mutex_lock(&shard->lock);
+	auto found = shard->entries.find(cacheKey);
+	if (found != shard->entries.end()) {
+		// another thread may have cached it from an older or newer snapshot, the latest txn wins
+		value_cache_entry_t* existing = found->second;
+		if (existing->txnId >= txnId) {
+			pthread_mutex_unlock(&shard->lock);
+			delete[] bytes;
+			return;
+		}
+		remove(shard, existing);
+	}
+	evict(shard, size);
+	value_cache_entry_t* entry = new value_cache_entry_t;
+	entry->key = cacheKey;
+	entry->txnId = txnId;
+	entry->data = bytes;
+	entry->size = data.mv_size;
+	entry->referenced = false;
+	entry->position = shard->clock.size();
+	shard->clock.push_back(entry);
+	shard->entries[cacheKey] = entry;
+	shard->bytes += size;
+	pthread_mutex_unlock(&shard->lock);
+}
+
+// sweep the clock hand, giving referenced entries a second chance, until there is room for the new entry
+void ValueCache::evict(shard_t* shard, size_t needed) {
+	while (shard->bytes + needed > maxShardBytes && !shard->clock.empty()) {
+		if (shard->hand >= shard->clock.size())
+			shard->hand = 0;
+		value_cache_entry_t* entry = shard->clock[shard->hand];
+		if (entry->referenced) {
+			entry->referenced = false;
+			shard->hand++;
+		} else
+			remove(shard, entry); // the last entry is moved into this slot, so the hand stays
+	}
+}
+
+void ValueCache::remove(shard_t* shard, value_cache_entry_t* entry) {
+	value_cache_entry_t* last = shard->clock.back();
+	shard->clock[entry->position] = last;
+	last->position = entry->position;
+	shard->clock.pop_back();
+	shard->entries.erase(entry->key);
+	shard->bytes -= entry->size + entry->key.size() - sizeof(MDB_dbi) + ENTRY_OVERHEAD;
+	delete[] entry->data;
+	delete entry;
+}
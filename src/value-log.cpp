@@ -0,0 +1,325 @@
+#include "lmdb-js.h"
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#endif
+
+using namespace Napi;
+
+// The log starts with a header page, followed by 8-byte aligned records of
+// [uint32 key size][uint32 value size][key][value]
+const char VALUE_LOG_MAGIC[8] = { 'L', 'M', 'D', 'B', 'V', 'L', 'O', 'G' };
+const mdb_size_t VALUE_LOG_HEADER_SIZE = 0x1000;
+// header words (after the magic number)
+const int TAIL = 1; // start of the records that may still be referenced
+const int PENDING_END = 2; // end of the range relocated by the last compaction (waiting for readers to finish)
+const int PENDING_TXN_ID = 3; // the write txn that relocated the pending range
+const int HEADER_WORDS = 4;
+#if UINTPTR_MAX > 0xffffffff
+const mdb_size_t DEFAULT_VALUE_LOG_MAP_SIZE = 0x10000000000ll; // 1TB of address space
+#else
+const mdb_size_t DEFAULT_VALUE_LOG_MAP_SIZE = 0x40000000; // 1GB of address space
+#endif
+
+ValueLog::ValueLog(unsigned int threshold) {
+	this->threshold = threshold;
+	this->fd = -1;
+	this->map = nullptr;
+	this->mapSize = 0;
+	this->end = 0;
+	this->dirty = false;
+}
+
+ValueLog::~ValueLog() {
+#ifndef _WIN32
+	if (map)
+		munmap(map, mapSize);
+	if (fd >= 0)
+		close(fd);
+#endif
+}
+
+#ifndef _WIN32
+static int writeFully(int fd, struct iovec* iov, int count, off_t offset) {
+	while (count > 0) {
+		ssize_t written = pwritev(fd, iov, count, offset);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		offset += written;
+		// advance past whatever was written
+		while (count > 0 && (size_t) written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count > 0) {
+			iov->iov_base = (char*) iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+	return 0;
+}
+#endif
+
+int ValueLog::open(const char* path, mdb_size_t mapSize) {
+#ifdef _WIN32
+	return ENOTSUP;
+#else
+	this->mapSize = mapSize ? mapSize : DEFAULT_VALUE_LOG_MAP_SIZE;
+	fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0664);
+	if (fd < 0)
+		return errno;
+	uint64_t header[HEADER_WORDS];
+	int rc = readHeader(header);
+	if (rc == MDB_NOTFOUND) {
+		// new log, the tail starts after the header
+		memset(header, 0, sizeof(header));
+		header[TAIL] = VALUE_LOG_HEADER_SIZE;
+		rc = writeHeader(header);
+	}
+	if (rc)
+		return rc;
+	// reserve the address space up front so references never need to be remapped, the file grows into it
+	void* address = mmap(nullptr, this->mapSize, PROT_READ, MAP_SHARED, fd, 0);
+	if (address == MAP_FAILED)
+		return errno;
+	map = (char*) address;
+	return 0;
+#endif
+}
+
+int ValueLog::readHeader(uint64_t* header) {
+#ifdef _WIN32
+	return ENOTSUP;
+#else
+	ssize_t bytesRead = pread(fd, header, sizeof(uint64_t) * HEADER_WORDS, 0);
+	if (bytesRead < 0)
+		return errno;
+	if (bytesRead == 0)
+		return MDB_NOTFOUND;
+	if (bytesRead < (ssize_t) (sizeof(uint64_t) * HEADER_WORDS) || memcmp(header, VALUE_LOG_MAGIC, 8))
+		return MDB_INVALID;
+	return 0;
+#endif
+}
+
+int ValueLog::writeHeader(uint64_t* header) {
+#ifdef _WIN32
+	return ENOTSUP;
+#else
+	memcpy(header, VALUE_LOG_MAGIC, 8);
+	struct iovec iov;
+	iov.iov_base = header;
+	iov.iov_len = sizeof(uint64_t) * HEADER_WORDS;
+	return writeFully(fd, &iov, 1, 0);
+#endif
+}
+
+int ValueLog::append(MDB_val& key, MDB_val& value, char* reference) {
+#ifdef _WIN32
+	return ENOTSUP;
+#else
+	// appending always happens under the write lock, but other processes may have appended, so check the end of the file
+	struct stat st;
+	if (fstat(fd, &st))
+		return errno;
+	mdb_size_t offset = ((mdb_size_t) st.st_size + 7) & ~((mdb_size_t) 7);
+	if (offset < VALUE_LOG_HEADER_SIZE)
+		offset = VALUE_LOG_HEADER_SIZE;
+	mdb_size_t valueOffset = offset + 8 + key.mv_size;
+	if (valueOffset + value.mv_size > mapSize)
+		return MDB_MAP_FULL;
+	uint32_t sizes[2] = { (uint32_t) key.mv_size, (uint32_t) value.mv_size };
+	struct iovec iov[3];
+	iov[0].iov_base = sizes;
+	iov[0].iov_len = 8;
+	iov[1].iov_base = key.mv_data;
+	iov[1].iov_len = key.mv_size;
+	iov[2].iov_base = value.mv_data;
+	iov[2].iov_len = value.mv_size;
+	int rc = writeFully(fd, iov, 3, offset);
+	if (rc)
+		return rc;
+	dirty = true;
+	if (valueOffset + value.mv_size > end)
+		end = valueOffset + value.mv_size;
+	memset(reference, 0, 4);
+	*((uint8_t*) reference) = VALUE_LOG_REFERENCE;
+	memcpy(reference + 4, &sizes[1], 4);
+	uint64_t offset64 = valueOffset;
+	memcpy(reference + 8, &offset64, 8);
+	return 0;
+#endif
+}
+
+bool ValueLog::resolve(MDB_val& data) {
+	uint32_t size;
+	uint64_t offset;
+	memcpy(&size, (char*) data.mv_data + 4, 4);
+	memcpy(&offset, (char*) data.mv_data + 8, 8);
+	if (!map || offset < VALUE_LOG_HEADER_SIZE || offset > mapSize || size > mapSize - offset)
+		return false;
+#ifndef _WIN32
+	if (offset + size > end) {
+		// past the end we have seen, check the file (other processes may have appended), since touching the map
+		// beyond the end of the file raises SIGBUS
+		struct stat st;
+		if (fstat(fd, &st) || offset + size > (mdb_size_t) st.st_size)
+			return false;
+		end = st.st_size;
+	}
+#endif
+	data.mv_data = map + offset;
+	data.mv_size = size;
+	return true;
+}
+
+int ValueLog::sync() {
+#ifdef _WIN32
+	return 0;
+#else
+	if (!dirty)
+		return 0;
+	dirty = false;
+#ifdef __APPLE__
+	if (fcntl(fd, F_FULLFSYNC))
+#else
+	if (fdatasync(fd))
+#endif
+		return errno;
+	return 0;
+#endif
+}
+
+/*
+	Compacts the log, must be called with a write txn. Live records in [tail, tail + maxBytes) (the ones still
+	referenced from the B-tree), up to the until offset, are appended again and their references updated. The range
+	is reclaimed (hole punched) by a later compaction, once this txn has committed and no reader can still be
+	referencing it. The position that compaction has reached and the end of the log are returned.
+*/
+int ValueLog::compact(MDB_txn* txn, MDB_dbi dbi, unsigned int headerSize, mdb_size_t maxBytes, mdb_size_t until,
+		mdb_size_t* position, mdb_size_t* end) {
+#ifdef _WIN32
+	return ENOTSUP;
+#else
+	uint64_t header[HEADER_WORDS];
+	int rc = readHeader(header);
+	if (rc)
+		return rc;
+	struct stat st;
+	if (fstat(fd, &st))
+		return errno;
+	*end = st.st_size;
+	if (!until || until > *end)
+		until = *end;
+	mdb_size_t txnId = mdb_txn_id(txn);
+	if (header[PENDING_END]) {
+		if (txnId <= header[PENDING_TXN_ID]) {
+			// the txn that relocated the pending range never committed (its txn id is being reused), so it is still live
+			header[PENDING_END] = 0;
+		} else {
+			mdb_size_t oldest = 0;
+#ifdef MDB_OVERLAPPINGSYNC
+			rc = mdb_txn_oldest(txn, &oldest);
+			if (rc)
+				return rc;
+#endif
+			if (oldest < header[PENDING_TXN_ID]) {
+				// readers may still reference the pending range, try again later
+				*position = header[PENDING_END];
+				return 0;
+			}
+			mdb_size_t start = header[TAIL];
+			mdb_size_t length = header[PENDING_END] - start;
+#if defined(FALLOC_FL_PUNCH_HOLE)
+			fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, start, length);
+#elif defined(F_PUNCHHOLE)
+			// must be block aligned
+			mdb_size_t alignedStart = (start + 0xfff) & ~((mdb_size_t) 0xfff);
+			mdb_size_t alignedEnd = (start + length) & ~((mdb_size_t) 0xfff);
+			if (alignedEnd > alignedStart) {
+				fpunchhole_t hole;
+				hole.fp_flags = 0;
+				hole.reserved = 0;
+				hole.fp_offset = alignedStart;
+				hole.fp_length = alignedEnd - alignedStart;
+				fcntl(fd, F_PUNCHHOLE, &hole);
+			}
+#endif
+			header[TAIL] = header[PENDING_END];
+			header[PENDING_END] = 0;
+		}
+		rc = writeHeader(header);
+		if (rc)
+			return rc;
+	}
+	mdb_size_t next = header[TAIL];
+	mdb_size_t scanEnd = maxBytes && next + maxBytes < until ? next + maxBytes : until;
+	char reference[EXTERNAL_REFERENCE_SIZE + 16];
+	char* referenceTarget = reference + headerSize;
+	while (next + 8 <= scanEnd) {
+		uint32_t sizes[2];
+		memcpy(sizes, map + next, 8);
+		if (sizes[0] == 0 && sizes[1] == 0) {
+			// A zeroed region, which is a hole punched by a compaction that crashed before the tail in the header was
+			// updated. Records never have an empty key and start on 8 byte boundaries, so skip to the data after it.
+			mdb_size_t skipTo = next + 8;
+#ifdef SEEK_DATA
+			off_t data = lseek(fd, next, SEEK_DATA);
+			if (data < 0 && errno == ENXIO)
+				skipTo = (scanEnd + 7) & ~((mdb_size_t) 7); // nothing but the hole to the end of the file
+			else if (data > (off_t) skipTo)
+				skipTo = ((mdb_size_t) data + 7) & ~((mdb_size_t) 7);
+#endif
+			next = skipTo;
+			continue;
+		}
+		mdb_size_t valueOffset = next + 8 + sizes[0];
+		if (valueOffset + sizes[1] > *end || sizes[0] == 0)
+			break; // incomplete record at the end (from an interrupted append)
+		MDB_val key, data, value;
+		key.mv_data = map + next + 8;
+		key.mv_size = sizes[0];
+		rc = mdb_get(txn, dbi, &key, &data);
+		if (rc == 0 && headerSize && data.mv_size >= headerSize) {
+			memcpy(reference, data.mv_data, headerSize); // preserve the version and expiration
+			data.mv_data = (char*) data.mv_data + headerSize;
+			data.mv_size -= headerSize;
+		}
+		uint64_t referencedOffset = 0;
+		if (rc == 0 && data.mv_size == EXTERNAL_REFERENCE_SIZE && *((uint8_t*) data.mv_data) == VALUE_LOG_REFERENCE)
+			memcpy(&referencedOffset, (char*) data.mv_data + 8, 8);
+		if (referencedOffset == valueOffset) {
+			// still live, move it to the end of the log
+			value.mv_data = map + valueOffset;
+			value.mv_size = sizes[1];
+			rc = append(key, value, referenceTarget);
+			if (rc)
+				return rc;
+			data.mv_data = reference;
+			data.mv_size = EXTERNAL_REFERENCE_SIZE + headerSize;
+			rc = mdb_put(txn, dbi, &key, &data, 0);
+			if (rc)
+				return rc;
+		} else if (rc && rc != MDB_NOTFOUND)
+			return rc;
+		next = (valueOffset + sizes[1] + 7) & ~((mdb_size_t) 7);
+	}
+	if (next > header[TAIL]) {
+		header[PENDING_END] = next;
+		header[PENDING_TXN_ID] = txnId;
+		rc = writeHeader(header);
+		if (rc)
+			return rc;
+	}
+	*position = next;
+	return 0;
+#endif
+}
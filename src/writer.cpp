@@ -47,6 +47,8 @@ const int ASSIGN_TIMESTAMP = 0x2000;
 const int SET_VERSION = 0x200;
 //const int HAS_INLINE_VALUE = 0x400;
 const int COMPRESSIBLE = 0x100000;
+const int DURABILITY_SYNC = 0x200000;
+const int DURABILITY_NO_SYNC = 0x400000;
 const int DELETE_DATABASE = 0x400;
 const int TXN_HAD_ERROR = 0x40000000;
 const int TXN_DELIMITER = 0x8000000;
@@ -73,6 +75,9 @@ WriteWorker::WriteWorker(MDB_env* env, EnvWrap* envForTxn, uint32_t* instruction
 		interruptionStatus = 0;
 		resultCode = 0;
 		txn = nullptr;
+		syncRequested = false;
+		syncOptional = true;
+		timeWaiting = 0;
 	}
 
 void WriteWorker::SendUpdate() {
@@ -120,6 +125,7 @@ int WriteWorker::WaitForCallbacks(MDB_txn** txn, bool allowCommit, uint32_t* tar
 		SendUpdate();
 	pthread_cond_signal(envForTxn->writingCond);
 	interruptionStatus = WORKER_WAITING;
+	uint64_t waitStart = get_time64();
 	uint64_t start;
 	unsigned int envFlags;
 	mdb_env_get_flags(env, &envFlags);
@@ -138,6 +144,7 @@ int WriteWorker::WaitForCallbacks(MDB_txn** txn, bool allowCommit, uint32_t* tar
 				if (envFlags & MDB_TRACK_METRICS)
 					envForTxn->timeTxnWaiting += get_time64() - start;
 #endif
+				timeWaiting += get_time64() - waitStart;
 				interruptionStatus = 0;
 				return 0;
 			}
@@ -152,6 +159,7 @@ int WriteWorker::WaitForCallbacks(MDB_txn** txn, bool allowCommit, uint32_t* tar
 	if (interruptionStatus == INTERRUPT_BATCH) { // interrupted by JS code that wants to run a synchronous transaction
 		interruptionStatus = RESTART_WORKER_TXN;
 		rc = mdb_txn_commit(*txn);
+		ExtendedEnv::publishChanges(env, rc == 0);
 #ifdef MDB_EMPTY_TXN
 		if (rc == MDB_EMPTY_TXN)
 			rc = 0;
@@ -173,8 +181,54 @@ int WriteWorker::WaitForCallbacks(MDB_txn** txn, bool allowCommit, uint32_t* tar
 		}
 	} else
 		interruptionStatus = 0;
+	timeWaiting += get_time64() - waitStart;
 	return 0;
 }
+append_tail_t* EnvWrap::getAppendTail(MDB_txn* txn, MDB_dbi dbi) {
+	if (dbi >= appendTails.size())
+		appendTails.resize(dbi + 1);
+	append_tail_t* tail = &appendTails[dbi];
+	mdb_size_t txnId = mdb_txn_id(txn);
+	if (tail->txnId != txnId) {
+		// a txn id can be reused after an abort, but the last key from that txn is still an upper bound
+		tail->txnId = txnId;
+		tail->state = TAIL_UNKNOWN;
+	}
+	return tail;
+}
+
+/*
+	Puts an entry, using MDB_APPEND when the key sorts after the last key put in this dbi by the txn (and that was
+	appended), or, for the first put, when it turns out to be after the last key. Appending skips the search, and
+	splits pages at the right edge by starting a new page rather than leaving two half-full pages.
+*/
+static int putMaybeAppending(MDB_txn* txn, EnvWrap* envForTxn, MDB_dbi dbi, MDB_val* key, MDB_val* value,
+		unsigned int flags, bool hasVersion, double version) {
+	append_tail_t* tail = nullptr;
+	if (!(flags & (MDB_APPEND | MDB_APPENDDUP))) {
+		tail = envForTxn->getAppendTail(txn, dbi);
+		MDB_val lastKey;
+		lastKey.mv_size = tail->lastKey.size();
+		lastKey.mv_data = tail->lastKey.data();
+		if (tail->state == TAIL_UNKNOWN || (tail->state == AT_TAIL && mdb_cmp(txn, dbi, key, &lastKey) > 0))
+			flags |= MDB_APPEND;
+	}
+	int rc = hasVersion ? putWithVersion(txn, dbi, key, value, flags, version) : mdb_put(txn, dbi, key, value, flags);
+	if (!tail || !(flags & MDB_APPEND))
+		return rc;
+	if (rc == MDB_KEYEXIST) {
+		// not at the end, use a normal put for this dbi for the rest of the txn
+		tail->state = NOT_AT_TAIL;
+		flags &= ~MDB_APPEND;
+		return hasVersion ? putWithVersion(txn, dbi, key, value, flags, version) : mdb_put(txn, dbi, key, value, flags);
+	}
+	if (rc == 0) {
+		tail->state = AT_TAIL;
+		tail->lastKey.assign((char*) key->mv_data, (char*) key->mv_data + key->mv_size);
+	}
+	return rc;
+}
+
 int WriteWorker::DoWrites(MDB_txn* txn, EnvWrap* envForTxn, uint32_t* instruction, WriteWorker* worker) {
 	MDB_val key, value;
 	int rc = 0;
@@ -182,6 +236,10 @@ int WriteWorker::DoWrites(MDB_txn* txn, EnvWrap* envForTxn, uint32_t* instructio
 	int validatedDepth = 0;
 	double conditionalVersion, setVersion = 0;
 	bool overlappedWord = !!worker;
+	ExtendedDbi* extendedDbi = nullptr;
+#ifdef MDB_OVERLAPPINGSYNC
+	ExtendedEnv* extendedEnv = (ExtendedEnv*) mdb_env_get_userctx(envForTxn->env);
+#endif
 	uint32_t* start;
     do {
 next_inst:	start = instruction++;
@@ -233,6 +291,11 @@ next_inst:	start = instruction++;
 				instruction += 2;
 				MDB_val conditionalValue;
 				rc = mdb_get(txn, dbi, &key, &conditionalValue);
+#ifdef MDB_OVERLAPPINGSYNC
+				if (rc == 0 && extendedEnv && (extendedDbi = extendedEnv->getExtendedDbi(dbi)) &&
+						extendedDbi->isExpired(conditionalValue))
+					rc = MDB_NOTFOUND; // expired entries are missing, even before they are swept
+#endif
 				if (rc) {
 				    // not found counts as version 0, so this is acceptable for conditional less than,
 				    // otherwise does not validate
@@ -252,6 +315,11 @@ next_inst:	start = instruction++;
 			}
 			if ((flags & IF_NO_EXISTS) && (flags & START_CONDITION_BLOCK)) {
 				rc = mdb_get(txn, dbi, &key, &value);
+#ifdef MDB_OVERLAPPINGSYNC
+				if (rc == 0 && extendedEnv && (extendedDbi = extendedEnv->getExtendedDbi(dbi)) &&
+						extendedDbi->isExpired(value))
+					rc = MDB_NOTFOUND;
+#endif
 				if (!rc)
 					validated = false;
 				else if (rc == MDB_NOTFOUND)
@@ -294,6 +362,7 @@ next_inst:	start = instruction++;
 				goto next_inst;
 			case PUT:
 #ifdef MDB_OVERLAPPINGSYNC
+				extendedDbi = ((ExtendedEnv*) mdb_env_get_userctx(envForTxn->env))->getExtendedDbi(dbi);
 				if (flags & ASSIGN_TIMESTAMP) {
 					if ((*(uint64_t*)key.mv_data & 0xfffffffful) == REPLACE_WITH_TIMESTAMP) {
 						ExtendedEnv* extended_env = (ExtendedEnv*) mdb_env_get_userctx(envForTxn->env);
@@ -314,7 +383,16 @@ next_inst:	start = instruction++;
 								MDB_val last_data;
 								rc = mdb_get(txn, dbi, &key, &last_data);
 								if (rc) break;
-								if (flags & SET_VERSION) last_data.mv_data = (char *) last_data.mv_data + 8;
+								if (flags & SET_VERSION) {
+									last_data.mv_data = (char *) last_data.mv_data + 8;
+									last_data.mv_size -= 8;
+								}
+								if (extendedDbi && extendedDbi->ttl) {
+									last_data.mv_data = (char *) last_data.mv_data + 8;
+									last_data.mv_size -= 8;
+								}
+								if (extendedDbi && extendedDbi->isReference(last_data))
+									extendedDbi->resolve(txn, last_data);
 								extended_env->previousTime = *(uint64_t *) last_data.mv_data;
 								//fprintf(stderr, "previous time %llx \n", previous_time);
 							}
@@ -329,6 +407,11 @@ next_inst:	start = instruction++;
 							//fprintf(stderr, "set time %llx \n", timestamp);
 						}
 						if (first_word & DIRECT_WRITE) {
+							if (extendedDbi) {
+								// the value may be stored externally, the B-tree only has the reference
+								rc = EINVAL;
+								break;
+							}
 							// direct in-place write
 							unsigned int offset = first_word >> 32;
 							if (flags & SET_VERSION)
@@ -359,14 +442,22 @@ next_inst:	start = instruction++;
 					}
 				}
 #endif
-				if (flags & SET_VERSION)
-					rc = putWithVersion(txn, dbi, &key, &value, flags & (MDB_NOOVERWRITE | MDB_NODUPDATA | MDB_APPEND | MDB_APPENDDUP), setVersion);
+				if (extendedDbi) // value log or deduplication
+					rc = extendedDbi->put(txn, dbi, &key, &value, flags & (MDB_NOOVERWRITE | MDB_NODUPDATA | MDB_APPEND | MDB_APPENDDUP), flags & SET_VERSION, setVersion);
 				else
-					rc = mdb_put(txn, dbi, &key, &value, flags & (MDB_NOOVERWRITE | MDB_NODUPDATA | MDB_APPEND | MDB_APPENDDUP));
+					rc = putMaybeAppending(txn, envForTxn, dbi, &key, &value, flags & (MDB_NOOVERWRITE | MDB_NODUPDATA | MDB_APPEND | MDB_APPENDDUP),
+						flags & SET_VERSION, setVersion);
 				if (flags & COMPRESSIBLE)
 					delete value.mv_data;
 				break;
 			case DEL:
+#ifdef MDB_OVERLAPPINGSYNC
+				extendedDbi = ((ExtendedEnv*) mdb_env_get_userctx(envForTxn->env))->getExtendedDbi(dbi);
+				if (extendedDbi) {
+					rc = extendedDbi->del(txn, dbi, &key);
+					break;
+				}
+#endif
 				rc = mdb_del(txn, dbi, &key, nullptr);
 				break;
 			case DEL_VALUE:
@@ -392,6 +483,14 @@ next_inst:	start = instruction++;
 				}
 				break;
 			case DROP_DB:
+#ifdef MDB_OVERLAPPINGSYNC
+				extendedDbi = ((ExtendedEnv*) mdb_env_get_userctx(envForTxn->env))->getExtendedDbi(dbi);
+				if (extendedDbi) {
+					rc = extendedDbi->drop(txn, dbi, (flags & DELETE_DATABASE) ? 1 : 0);
+					break;
+				}
+#endif
+				envForTxn->getAppendTail(txn, dbi)->state = TAIL_UNKNOWN;
 				rc = mdb_drop(txn, dbi, (flags & DELETE_DATABASE) ? 1 : 0);
 				break;
 			case POINTER_NEXT:
@@ -403,6 +502,18 @@ next_inst:	start = instruction++;
 				worker->resultCode = 22;
 				abort();
 			}
+#ifdef MDB_OVERLAPPINGSYNC
+			// PUT, DEL, DEL_VALUE and DROP_DB change entries that readers may have cached
+			if ((flags & 0xf) >= DROP_DB && extendedEnv)
+				extendedEnv->recordChange(txn, dbi, (flags & 0xf) == DROP_DB ? nullptr : &key);
+#endif
+			if (worker) {
+				// a txn is synced if any of its instructions needs it, and can only skip the sync if every write allows it
+				if (flags & DURABILITY_SYNC)
+					worker->syncRequested = true;
+				if (((flags & 0xf) >= DROP_DB || (flags & 0xf) == USER_CALLBACK) && !(flags & DURABILITY_NO_SYNC))
+					worker->syncOptional = false;
+			}
 			if (rc) {
 				if (!(rc == MDB_KEYEXIST || rc == MDB_NOTFOUND)) {
 					if (worker) {
@@ -418,6 +529,8 @@ next_inst:	start = instruction++;
 		} else
 			flags = FINISHED_OPERATION | FAILED_CONDITION;
 		//fprintf(stderr, "finished flag %p\n", flags);
+		if (worker)
+			envForTxn->writeQueueStats[0]++;
 		if (overlappedWord) {
 			std::atomic_fetch_or((std::atomic<uint32_t>*) start, flags);
 			overlappedWord = false;
@@ -441,11 +554,26 @@ void txn_callback(const void* data, int finished) {
 			pthread_cond_signal(worker->envForTxn->writingCond); // in case there a sync txn waiting for us
 			pthread_mutex_unlock(worker->envForTxn->writingLock);
 		}
-	} else // transaction is visible (to readers), but not unlocked
+	} else { // transaction is visible (to readers), but not unlocked
+		ExtendedEnv::publishChanges(worker->env, true);
 		worker->SendUpdate();
+	}
 }
 
 
+// smooth over recent txns, so the estimate follows changes in the write load without jumping with every txn
+static void smoothStat(double* stat, double value) {
+	*stat = *stat ? *stat * 0.75 + value * 0.25 : value;
+}
+
+void WriteWorker::recordWriteRate(double processed, uint64_t writeStart, uint64_t commitStart) {
+	double* stats = envForTxn->writeQueueStats;
+	double writingTime = ((double) (commitStart - writeStart) - (double) timeWaiting) * 1000 / TICKS_PER_SECOND;
+	if (processed > 0 && writingTime > 0)
+		smoothStat(&stats[1], processed / writingTime);
+	smoothStat(&stats[2], (double) (get_time64() - commitStart) * 1000 / TICKS_PER_SECOND);
+}
+
 void do_write(napi_env env, void* data) {
 	auto worker = (WriteWorker*) data;
 	worker->Write();
@@ -488,7 +616,13 @@ void WriteWorker::Write() {
 		return;
 	}
 	uint32_t* start = instructions;
+	syncRequested = false;
+	syncOptional = true;
+	timeWaiting = 0;
+	double processedStart = envForTxn->writeQueueStats[0];
+	uint64_t writeStart = get_time64();
 	rc = DoWrites(txn, envForTxn, instructions, this);
+	uint64_t commitStart = get_time64();
 	uint32_t txnId = (uint32_t) mdb_txn_id(txn);
 	if (!(*instructions & TXN_DELIMITER))
 		fprintf(stderr, "after writes %p %p NOT still valid %p\n", start, instructions, *instructions);
@@ -502,8 +636,17 @@ void WriteWorker::Write() {
 	if (rc || resultCode) {
 		fprintf(stderr, "do_write error %u %u\n", rc, resultCode);
 		mdb_txn_abort(txn);
+		ExtendedEnv::publishChanges(env, false);
 	} else {
+		bool syncAfterCommit = false;
+		if (envFlags & MDB_NOSYNC)
+			syncAfterCommit = syncRequested; // the env never syncs on its own, so an fsync after the commit covers this and earlier txns
+		else if (syncOptional && !syncRequested)
+			mdb_txn_set_sync(txn, 0); // every write in this txn accepted a commit without an fsync (overlapping sync txns already are)
 		rc = mdb_txn_commit(txn);
+		bool committed = !rc;
+		if (!rc && syncAfterCommit)
+			rc = mdb_env_sync(env, 1);
 #ifdef MDB_EMPTY_TXN
 		if (rc == MDB_EMPTY_TXN)
 			rc = 0;
@@ -513,7 +656,9 @@ void WriteWorker::Write() {
 #else
 		had_changes = true;
 #endif
+		ExtendedEnv::publishChanges(env, committed); // if it wasn't already published when the txn became visible
 	}
+	recordWriteRate(envForTxn->writeQueueStats[0] - processedStart, writeStart, commitStart);
 	if (!(*instructions & TXN_DELIMITER))
 		fprintf(stderr, "end write %p, next start %p NOT still valid %p\n", start, instructions, *instructions);
 	txn_callback(this, 1);
@@ -4,7 +4,7 @@ import rimraf from 'rimraf';
 
 let should = chai.should();
 let expect = chai.expect;
-import { spawn } from 'child_process';
+import { spawn, execFileSync } from 'child_process';
 import { unlinkSync } from 'fs';
 import { fileURLToPath } from 'url';
 import { Worker } from 'worker_threads';
@@ -107,6 +107,7 @@ describe('lmdb-js', function () {
 							useVersions: true,
 							batchStartThreshold: 10,
 							maxReaders: 100,
+							maxDbs: 32,
 							keyEncoder: orderedBinaryEncoder,
 							/*compression: {
 								threshold: 256,
@@ -840,6 +841,210 @@ describe('lmdb-js', function () {
 				}
 				count.should.equal(0);
 			});
+			it('should bulk read dupFixed values', async function () {
+				let dbFixed = db.openDB({
+					name: 'mydb-fixed',
+					create: true,
+					dupSort: true,
+					dupFixed: true,
+					encoding: 'binary',
+					compression: false,
+				});
+				dbFixed.getValuesFixed('key1').length.should.equal(0);
+				let lastPut;
+				for (let i = 0; i < 3000; i++) {
+					let value = Buffer.alloc(4);
+					value.writeUInt32BE(i);
+					lastPut = dbFixed.put('key1', value);
+				}
+				await dbFixed.put('key2', Buffer.from([1, 2, 3, 4]));
+				await lastPut;
+				let values = dbFixed.getValuesFixed('key1');
+				values.length.should.equal(12000);
+				for (let i = 0; i < 3000; i++) {
+					values.readUInt32BE(i * 4).should.equal(i);
+				}
+				let single = dbFixed.getValuesFixed('key2', { arrayType: Uint8Array });
+				Array.from(single).should.deep.equal([1, 2, 3, 4]);
+				dbFixed
+					.getValuesFixed('key1', { arrayType: Uint32Array })
+					.length.should.equal(3000);
+			});
+			it('should store large values in the value log', async function () {
+				if (process.platform == 'win32' || options.encryptionKey) return;
+				let dbLog = db.openDB({
+					name: 'mydb-value-log',
+					create: true,
+					useVersions: true,
+					valueLog: { threshold: 1000 },
+				});
+				let large = 'x'.repeat(5000);
+				await dbLog.put('large', { large, version: 1 }, 1);
+				await dbLog.put('small', { small: true });
+				dbLog.get('large').should.deep.equal({ large, version: 1 });
+				dbLog.getEntry('large').version.should.equal(1);
+				dbLog.get('small').should.deep.equal({ small: true });
+				for (let i = 0; i < 20; i++) {
+					await dbLog.put('large', { large, version: i + 2 }, i + 2);
+				}
+				await dbLog.put('large-2', { large: large + 'y' });
+				await dbLog.remove('large-2');
+				await dbLog.put('large-3', { large: large + 'z' });
+				await dbLog.compactValueLog();
+				dbLog.get('large').should.deep.equal({ large, version: 21 });
+				dbLog.getEntry('large').version.should.equal(21);
+				should.equal(dbLog.get('large-2'), undefined);
+				dbLog.get('large-3').should.deep.equal({ large: large + 'z' });
+				Array.from(dbLog.getRange({ start: 'large' }))
+					.map(({ key }) => key)
+					.should.deep.equal(['large', 'large-3', 'small']);
+			});
+			it('should compact past a hole left by a crashed compaction', async function () {
+				if (process.platform == 'win32' || options.encryptionKey) return;
+				let dbLog = db.openDB({
+					name: 'mydb-value-log-hole',
+					create: true,
+					valueLog: { threshold: 1000 },
+				});
+				let logPath = db.path + '-mydb-value-log-hole.vlog';
+				function randomValue() {
+					let value = Buffer.alloc(5000); // incompressible, so it stays in the log
+					for (let i = 0; i < value.length; i++) value[i] = Math.random() * 256;
+					return value;
+				}
+				await dbLog.put('dead-1', randomValue());
+				await dbLog.put('dead-2', randomValue());
+				let deadEnd = fs.statSync(logPath).size;
+				let live = randomValue();
+				await dbLog.put('live', live);
+				await dbLog.remove('dead-1');
+				await dbLog.remove('dead-2');
+				// punch the dead records out, like a compaction that crashed before the tail in the header was updated
+				let fd = fs.openSync(logPath, 'r+');
+				fs.writeSync(fd, Buffer.alloc(deadEnd - 0x1000), 0, deadEnd - 0x1000, 0x1000);
+				fs.closeSync(fd);
+				let sizeBefore = fs.statSync(logPath).size;
+				await dbLog.compactValueLog();
+				// the live record after the hole was reached and relocated to the end
+				fs.statSync(logPath).size.should.be.greaterThan(sizeBefore);
+				Buffer.from(dbLog.get('live')).equals(live).should.equal(true);
+				should.equal(dbLog.get('dead-1'), undefined);
+			});
+			it('should report references past the end of a truncated value log', async function () {
+				if (process.platform == 'win32' || options.encryptionKey) return;
+				let path = testDirPath + '/value-log-truncated-' + testIteration + '.mdb';
+				let truncatedDb = open(path, {});
+				let dbLog = truncatedDb.openDB({
+					name: 'truncated',
+					create: true,
+					valueLog: { threshold: 1000 },
+				});
+				await dbLog.put('large', 'x'.repeat(5000));
+				await truncatedDb.close();
+				fs.truncateSync(path + '-truncated.vlog', 0x1000);
+				truncatedDb = open(path, {});
+				dbLog = truncatedDb.openDB({
+					name: 'truncated',
+					valueLog: { threshold: 1000 },
+				});
+				expect(() => dbLog.get('large')).to.throw();
+				await truncatedDb.close();
+			});
+			it('should deduplicate large values', async function () {
+				if (process.platform == 'win32') return;
+				let dbDedup = db.openDB({
+					name: 'mydb-dedup',
+					create: true,
+					dedup: { threshold: 1000 },
+				});
+				let large = 'x'.repeat(5000);
+				for (let i = 0; i < 5; i++) {
+					await dbDedup.put('shared-' + i, { large });
+				}
+				await dbDedup.put('other', { large: large + 'y' });
+				await dbDedup.put('small', { small: true });
+				await dbDedup.put('shared-1', { large: large + 'y' });
+				await dbDedup.remove('shared-2');
+				dbDedup.get('shared-0').should.deep.equal({ large });
+				dbDedup.get('shared-1').should.deep.equal({ large: large + 'y' });
+				should.equal(dbDedup.get('shared-2'), undefined);
+				dbDedup.get('small').should.deep.equal({ small: true });
+				for (let i = 0; i < 5; i++) {
+					if (i != 1 && i != 2)
+						await dbDedup.remove('shared-' + i);
+				}
+				dbDedup.get('other').should.deep.equal({ large: large + 'y' });
+				Array.from(dbDedup.getRange({}))
+					.map(({ key, value }) => key + ':' + value.large?.length)
+					.should.deep.equal(['other:5001', 'shared-1:5001', 'small:undefined']);
+			});
+			it('should bulk load sorted entries', async function () {
+				let dbLoad = db.openDB({
+					name: 'mydb-bulk-load',
+					create: true,
+				});
+				let entries = [];
+				for (let i = 0; i < 2000; i++) {
+					entries.push({ key: i, value: { i, text: 'value ' + i } });
+				}
+				dbLoad.bulkLoad(entries, { fillFactor: 80 }).should.equal(2000);
+				dbLoad.get(1234).should.deep.equal({ i: 1234, text: 'value 1234' });
+				Array.from(dbLoad.getKeys()).length.should.equal(2000);
+				// the same entries loaded into full pages take fewer leaf pages than at the fill factor
+				let dbFull = db.openDB({
+					name: 'mydb-bulk-load-full',
+					create: true,
+				});
+				dbFull.bulkLoad(entries).should.equal(2000);
+				let fullPages = dbFull.getStats().treeLeafPageCount;
+				let filledPages = dbLoad.getStats().treeLeafPageCount;
+				filledPages.should.be.greaterThan(fullPages);
+				filledPages.should.be.at.most(Math.ceil(fullPages * 1.5));
+				dbLoad
+					.bulkLoad([{ key: 2000, value: 'end' }, { key: 2001, value: 'end' }])
+					.should.equal(2);
+				should.throw(() =>
+					dbLoad.bulkLoad([
+						{ key: 3000, value: 'aborted' },
+						{ key: 5, value: 'out of order' },
+					]),
+				);
+				should.equal(dbLoad.get(3000), undefined);
+				dbLoad.get(5).should.deep.equal({ i: 5, text: 'value 5' });
+				await dbLoad.drop();
+			});
+			it('should write increasing and out of order keys in one batch', async function () {
+				let dbAppend = db.openDB({
+					name: 'mydb-append',
+					create: true,
+				});
+				await dbAppend.put(50, 'existing');
+				let writes = [];
+				for (let i = 100; i < 200; i++) writes.push(dbAppend.put(i, 'value ' + i));
+				writes.push(dbAppend.put(10, 'before'));
+				writes.push(dbAppend.put(150, 'replaced'));
+				for (let i = 200; i < 300; i++) writes.push(dbAppend.put(i, 'value ' + i));
+				await Promise.all(writes);
+				dbAppend.get(10).should.equal('before');
+				dbAppend.get(150).should.equal('replaced');
+				dbAppend.get(299).should.equal('value 299');
+				Array.from(dbAppend.getKeys()).length.should.equal(202);
+				await dbAppend.drop();
+			});
+			it('should read large values without copying in a read txn', async function () {
+				let large = 'z'.repeat(20000);
+				await db.put('zero-copy', { large });
+				let copied = db.getBinary('zero-copy');
+				let transaction = db.useReadTransaction();
+				try {
+					let bytes = db.getBinary('zero-copy', { transaction, zeroCopy: true });
+					Buffer.from(bytes).equals(Buffer.from(copied)).should.equal(true);
+					db.get('zero-copy', { transaction, zeroCopy: true }).should.deep.equal({ large });
+				} finally {
+					transaction.done();
+				}
+				await db.remove('zero-copy');
+			});
 			it('doesExist', async function () {
 				should.equal(db.doesExist('does-exist-test'), false);
 				if (db.isCaching) {
@@ -912,6 +1117,69 @@ describe('lmdb-js', function () {
 						should.equal(results[i], 'value' + i);
 					}
 				});
+			if (!options.encryptionKey)
+				it('getAsync batch across dbs', async function () {
+					await db.put('batch-a', 'a');
+					await db2.put('batch-b', 'b');
+					// these are all recorded in one turn and read as one batch
+					let results = await Promise.all([
+						db.getAsync('batch-a'),
+						db2.getAsync('batch-b'),
+						db.getAsync('batch-a'),
+					]);
+					should.equal(results[0], 'a');
+					should.equal(results[1], 'b');
+					should.equal(results[2], 'a');
+				});
+			if (!options.encryptionKey)
+				it('getAsync across many results buffers', async function () {
+					let value = 'r'.repeat(3000);
+					for (let i = 0; i < 100; i++) {
+						db.put('async-many' + i, value + i);
+					}
+					await db.committed;
+					// several rounds fill and retire the results buffers so they get reclaimed and reused
+					for (let round = 0; round < 4; round++) {
+						let gets = [];
+						for (let i = 0; i < 100; i++) {
+							gets.push(db.getAsync('async-many' + i));
+						}
+						let results = await Promise.all(gets);
+						for (let i = 0; i < 100; i++) {
+							should.equal(results[i], value + i);
+						}
+					}
+				});
+			if (!options.encryptionKey)
+				it('getAsync binary results outlive the results buffers', async function () {
+					let dbBinary = db.openDB({
+						name: 'mydb-async-binary',
+						create: true,
+						encoding: 'binary',
+						compression: false,
+					});
+					for (let i = 0; i < 100; i++) {
+						dbBinary.put('small' + i, Buffer.alloc(3000, i));
+					}
+					await dbBinary.put('large', Buffer.alloc(0x50000, 7));
+					let first = await dbBinary.getAsync('small0');
+					for (let round = 0; round < 4; round++) {
+						let gets = [];
+						for (let i = 0; i < 100; i++) {
+							gets.push(dbBinary.getAsync('small' + i));
+						}
+						gets.push(dbBinary.getAsync('large'));
+						let results = await Promise.all(gets);
+						for (let i = 0; i < 100; i++) {
+							results[i][2999].should.equal(i);
+						}
+						results[100].length.should.equal(0x50000);
+						results[100][0x4ffff].should.equal(7);
+					}
+					// the earliest result is still intact after its results buffer has been reused
+					first.length.should.equal(3000);
+					first[2999].should.equal(0);
+				});
 			it('getUserSharedBuffer', function () {
 				let defaultIncrementer = new BigInt64Array(1);
 				let incrementer = new BigInt64Array(
@@ -980,6 +1248,299 @@ describe('lmdb-js', function () {
 					{ key: 'key133333', value: 4 },
 				]);
 			});
+			it('prefetch reuses read txns from the pool', async function () {
+				let poolDb = open(testDirPath + '/test-read-txn-pool-' + testIteration + '.mdb', {
+					readTxnPoolSize: 2,
+					maxReaders: 16,
+				});
+				function activeReaders() {
+					return poolDb.readerList().split('\n').filter((line) => /^\s*\d+\s/.test(line)).length;
+				}
+				let keys = [];
+				for (let i = 0; i < 20; i++) {
+					keys.push('pool' + i);
+					poolDb.put('pool' + i, 'value' + i);
+				}
+				await poolDb.committed;
+				// far more prefetches than reader slots, they can only all succeed if the txns are reused or released
+				for (let round = 0; round < 10; round++) {
+					let prefetches = [];
+					for (let i = 0; i < 20; i++) prefetches.push(poolDb.prefetch(keys));
+					await Promise.all(prefetches);
+				}
+				// only the pooled (reset) txns and the main thread's read txn keep their reader slots
+				activeReaders().should.be.lessThanOrEqual(4);
+				// a pooled txn is renewed, so it sees later commits
+				await poolDb.put('pool-new', 'new value');
+				(await poolDb.getMany(['pool-new', 'pool1'])).should.deep.equal(['new value', 'value1']);
+				await poolDb.close();
+			});
+			it('prefetch large values', async function () {
+				let large = '';
+				for (let i = 0; large.length < 100000; i++) large += ((i * 7919) % 10007).toString(36);
+				let keys = [];
+				for (let i = 0; i < 5; i++) {
+					keys.push('large-prefetch' + i);
+					db.put('large-prefetch' + i, large + i);
+				}
+				await db.committed;
+				// values spanning many pages are brought in as a run, they must still read back intact
+				await db.prefetch(keys);
+				let values = await db.getMany(keys);
+				for (let i = 0; i < 5; i++) values[i].should.equal(large + i);
+				if (!options.encryptionKey) (await db.getAsync('large-prefetch3')).should.equal(large + 3);
+			});
+			it('scan with read ahead', async function () {
+				let dbScan = db.openDB({ name: 'mydb-scan', create: true, scanReadAhead: 4 });
+				for (let i = 0; i < 2000; i++) {
+					dbScan.put('scan' + (10000 + i), 'value'.repeat(20) + i);
+				}
+				await dbScan.committed;
+				let count = 0;
+				for (let { key, value } of dbScan.getRange({ start: 'scan' })) {
+					value.should.equal('value'.repeat(20) + (key.slice(4) - 10000));
+					count++;
+				}
+				count.should.equal(2000);
+				// reverse scans aren't read ahead, but still iterate normally
+				dbScan.getRange({ start: 'scan' + 10100, reverse: true }).asArray.length.should.equal(101);
+			});
+			it('Bloom filter', async function () {
+				let dbBloom = db.openDB({ name: 'mydb-bloom', create: true, bloomFilter: { expectedKeys: 1000 } });
+				for (let i = 0; i < 500; i++) {
+					dbBloom.put('present' + i, i);
+				}
+				await dbBloom.committed;
+				for (let i = 0; i < 500; i++) {
+					dbBloom.get('present' + i).should.equal(i);
+					should.equal(dbBloom.get('absent' + i), undefined);
+				}
+				dbBloom.doesExist('present1').should.equal(true);
+				dbBloom.doesExist('absent1').should.equal(false);
+				await dbBloom.clearAsync();
+				should.equal(dbBloom.get('present1'), undefined);
+				await dbBloom.put('present1', 1);
+				dbBloom.get('present1').should.equal(1);
+			});
+			it('Bloom filter is rebuilt past its capacity', async function () {
+				let path = testDirPath + '/test-bloom-' + testIteration + '.mdb';
+				let bloomEnv = open(path, { maxDbs: 4 });
+				let dbBloom = bloomEnv.openDB({ name: 'bloom', create: true, bloomFilter: { expectedKeys: 100 } });
+				for (let i = 0; i < 3000; i++) {
+					dbBloom.put('present' + i, i);
+				}
+				await dbBloom.committed;
+				// a single block for 3000 keys, nearly every bit is set
+				let bloomStats = dbBloom.getStats().bloomFilter;
+				bloomStats.blocks.should.equal(1);
+				bloomStats.falsePositiveRate.should.be.greaterThan(0.5);
+				await bloomEnv.close();
+				bloomEnv = open(path, { maxDbs: 4 });
+				dbBloom = bloomEnv.openDB({ name: 'bloom', bloomFilter: { expectedKeys: 100 } });
+				bloomStats = dbBloom.getStats().bloomFilter;
+				bloomStats.blocks.should.be.greaterThan(1);
+				bloomStats.falsePositiveRate.should.be.lessThan(0.05);
+				for (let i = 0; i < 3000; i++) {
+					dbBloom.get('present' + i).should.equal(i);
+					should.equal(dbBloom.get('absent' + i), undefined);
+				}
+				await dbBloom.put('present3000', 3000);
+				dbBloom.get('present3000').should.equal(3000);
+				await bloomEnv.close();
+			});
+			it('native indexes', async function () {
+				let dbIndexed = db.openDB({
+					name: 'mydb-indexed',
+					create: true,
+					encoding: 'binary',
+					keyEncoding: 'binary',
+					indexes: [{ name: 'mydb-by-type', offset: 0, length: 4 }],
+				});
+				let dbByType = db.openDB({
+					name: 'mydb-by-type',
+					dupSort: true,
+					encoding: 'binary',
+					keyEncoding: 'binary',
+				});
+				dbIndexed.put(Buffer.from('item1'), Buffer.from('cat:one'));
+				dbIndexed.put(Buffer.from('item2'), Buffer.from('cat:two'));
+				await dbIndexed.put(Buffer.from('item3'), Buffer.from('dog:three'));
+				let byType = (type) =>
+					Array.from(dbByType.getValues(Buffer.from(type))).map((key) => key.toString());
+				byType('cat:').should.deep.equal(['item1', 'item2']);
+				byType('dog:').should.deep.equal(['item3']);
+				// changing the indexed bytes moves the entry, deleting removes it
+				dbIndexed.put(Buffer.from('item2'), Buffer.from('dog:two'));
+				await dbIndexed.remove(Buffer.from('item1'));
+				byType('cat:').should.deep.equal([]);
+				byType('dog:').should.deep.equal(['item2', 'item3']);
+				await dbIndexed.clearAsync();
+				byType('dog:').should.deep.equal([]);
+			});
+			it('history and getAsOf', async function () {
+				let dbHistory = db.openDB({
+					name: 'mydb-history',
+					create: true,
+					useVersions: true,
+					history: { maxVersions: 2 },
+				});
+				await dbHistory.put('doc', 'first', 1);
+				await dbHistory.put('doc', 'second', 2);
+				await dbHistory.put('doc', 'third', 5);
+				await dbHistory.put('doc', 'fourth', 7);
+				dbHistory.get('doc').should.equal('fourth');
+				dbHistory.getAsOf('doc', 10).should.deep.equal({ value: 'fourth', version: 7 });
+				dbHistory.getAsOf('doc', 6).should.deep.equal({ value: 'third', version: 5 });
+				dbHistory.getAsOf('doc', 3).should.deep.equal({ value: 'second', version: 2 });
+				// only the last two superseded versions are retained
+				should.equal(dbHistory.getAsOf('doc', 1), undefined);
+				should.equal(dbHistory.getAsOf('missing', 10), undefined);
+				// a removed entry stays in the history, but it is missing as of any later version
+				await dbHistory.remove('doc');
+				should.equal(dbHistory.get('doc'), undefined);
+				dbHistory.getAsOf('doc', 7).should.deep.equal({ value: 'fourth', version: 7 });
+				should.equal(dbHistory.getAsOf('doc', 10), undefined);
+				// and until it is put again
+				await dbHistory.put('doc', 'fifth', 12);
+				should.equal(dbHistory.getAsOf('doc', 10), undefined);
+				dbHistory.getAsOf('doc', 12).should.deep.equal({ value: 'fifth', version: 12 });
+				// clearing removes the entries the same way
+				await dbHistory.put('other', 'first', 3);
+				await dbHistory.clearAsync();
+				should.equal(dbHistory.get('doc'), undefined);
+				dbHistory.getAsOf('doc', 12).should.deep.equal({ value: 'fifth', version: 12 });
+				should.equal(dbHistory.getAsOf('doc', 13), undefined);
+				dbHistory.getAsOf('other', 3).should.deep.equal({ value: 'first', version: 3 });
+				should.equal(dbHistory.getAsOf('other', 4), undefined);
+			});
+			it('ttl and sweeping', async function () {
+				let dbTtl = db.openDB({ name: 'mydb-ttl', create: true, ttl: 100, sweepInterval: false });
+				await dbTtl.put('session1', 'expiring');
+				dbTtl.get('session1').should.equal('expiring');
+				await new Promise((resolve) => setTimeout(resolve, 150));
+				// expired entries are missing, even before they are swept
+				should.equal(dbTtl.get('session1'), undefined);
+				Array.from(dbTtl.getKeys()).should.deep.equal([]);
+				await dbTtl.put('session2', 'fresh');
+				(await dbTtl.sweepExpired()).should.equal(1);
+				dbTtl.get('session2').should.equal('fresh');
+				Array.from(dbTtl.getKeys()).should.deep.equal(['session2']);
+			});
+			it('ttl conditional writes over expired entries', async function () {
+				let dbTtl = db.openDB({
+					name: 'mydb-ttl-conditional',
+					create: true,
+					useVersions: true,
+					ttl: 100,
+					sweepInterval: false,
+				});
+				await dbTtl.put('lock', 'first', 1);
+				await dbTtl.put('versioned', 'first', 1);
+				(await dbTtl.ifNoExists('lock', () => dbTtl.put('lock', 'second', 2))).should.equal(false);
+				(await dbTtl.put('versioned', 'second', 2, null)).should.equal(false);
+				await new Promise((resolve) => setTimeout(resolve, 150));
+				// expired entries are missing to conditional writes too, before they are swept
+				(await dbTtl.ifNoExists('lock', () => dbTtl.put('lock', 'third', 3))).should.equal(true);
+				dbTtl.getEntry('lock').should.deep.equal({ value: 'third', version: 3 });
+				(await dbTtl.ifVersion('versioned', 1, () => dbTtl.put('versioned', 'third', 3))).should.equal(false);
+				(await dbTtl.put('versioned', 'fourth', 4, null)).should.equal(true);
+				dbTtl.getEntry('versioned').should.deep.equal({ value: 'fourth', version: 4 });
+			});
+			it('durability levels', async function () {
+				(await db.put('durable-none', 'a', { durability: 'none' })).should.equal(true);
+				(await db.put('durable-sync', 'b', { durability: 'sync' })).should.equal(true);
+				(await db.batch(() => {
+					db.put('durable-batch1', 'c');
+					db.put('durable-batch2', 'd', { durability: 'sync' });
+				}, { durability: 'flush' })).should.equal(true);
+				db.get('durable-none').should.equal('a');
+				db.get('durable-sync').should.equal('b');
+				db.get('durable-batch2').should.equal('d');
+				expect(() => db.put('durable-bad', 'e', { durability: 'eventually' })).to.throw();
+			});
+			it('durability levels decide whether each txn is synced', async function () {
+				for (let noSync of [false, true]) {
+					let syncDb = open(testDirPath + '/test-durability-' + noSync + '-' + testIteration + '.mdb', {
+						noSync,
+						overlappingSync: false,
+						trackMetrics: true,
+					});
+					let before = syncDb.getStats();
+					// every write allows skipping the sync, so the txn is committed without one
+					await syncDb.batch(() => {
+						syncDb.put('none1', 1);
+						syncDb.put('none2', 2);
+					}, { durability: 'none' });
+					let after = syncDb.getStats();
+					after.txns.should.equal(before.txns + 1);
+					after.syncedTxns.should.equal(before.syncedTxns);
+					after.syncs.should.equal(before.syncs);
+					// one write that needs a sync makes the whole txn synced
+					before = after;
+					syncDb.put('mixed1', 1, { durability: 'none' });
+					await syncDb.put('mixed2', 2, { durability: 'sync' });
+					after = syncDb.getStats();
+					after.txns.should.equal(before.txns + 1);
+					// with noSync the txn itself isn't synced, the writer syncs the env after committing it
+					after.syncedTxns.should.equal(before.syncedTxns + (noSync ? 0 : 1));
+					after.syncs.should.be.greaterThan(before.syncs);
+					syncDb.get('mixed1').should.equal(1);
+					await syncDb.close();
+				}
+			});
+			it('low priority writes', async function () {
+				let bulk = [];
+				for (let i = 0; i < 3000; i++)
+					bulk.push(db.put('low-priority' + i, 'bulk' + i, { priority: 'low' }));
+				let value = Buffer.from('copied');
+				let lowPriorityPut = db.put('low-priority-copied', asBinary(value), { priority: 'low' });
+				value[0] = 0; // already copied
+				(await db.put('normal-priority', 'first')).should.equal(true);
+				// the normal write isn't committed behind all the low priority writes
+				if (!db.cache) should.equal(db.get('low-priority2999'), undefined);
+				(await Promise.all(bulk)).length.should.equal(3000);
+				await lowPriorityPut;
+				db.get('low-priority2999').should.equal('bulk2999');
+				db.getBinary('low-priority-copied').toString().should.equal('copied');
+			});
+			it('committed waits for low priority writes', async function () {
+				for (let i = 0; i < 3000; i++) db.put('low-committed' + i, 'bulk' + i, { priority: 'low' });
+				db.put('low-committed-last', 'last', { priority: 'low' });
+				// the queued low priority writes are part of the queue depth
+				db.getWriteQueueStats().queueDepth.should.be.above(3000);
+				await db.committed;
+				db.get('low-committed-last').should.equal('last');
+				db.get('low-committed2999').should.equal('bulk2999');
+				db.getWriteQueueStats().queueDepth.should.equal(0);
+				db.put('low-flushed', 'flushed', { priority: 'low' });
+				await db.flushed;
+				db.get('low-flushed').should.equal('flushed');
+			});
+			it('write queue stats and backpressure', async function () {
+				for (let i = 0; i < 100; i++) db.put('queue-stats' + i, 'value' + i);
+				db.getWriteQueueStats().bytesPending.should.be.above(0);
+				await db.committed;
+				let stats = db.getWriteQueueStats();
+				stats.queueDepth.should.equal(0);
+				stats.bytesPending.should.equal(0);
+				stats.estimatedDrainTime.should.be.a('number');
+				(await db.backpressure()).should.equal(true);
+			});
+			it('prefetchRange', async function () {
+				for (let i = 0; i < 500; i++) {
+					db.put('range-prefetch' + (1000 + i), 'value'.repeat(50) + i);
+				}
+				await db.committed;
+				await db.prefetchRange('range-prefetch1100', 'range-prefetch1200');
+				await new Promise((resolve) =>
+					db.prefetchRange('range-prefetch', undefined, 10000, resolve),
+				);
+				let entries = Array.from(
+					db.getRange({ start: 'range-prefetch1100', end: 'range-prefetch1200' }),
+				);
+				entries.length.should.equal(100);
+				entries[0].value.should.equal('value'.repeat(50) + 100);
+			});
 
 			it('invalid key', async function () {
 				expect(() => db.get(Buffer.from([]))).to.throw();
@@ -1924,6 +2485,106 @@ describe('lmdb-js', function () {
 			}
 			serializedKeys.should.deep.equal(keys);
 		});
+		it('should write and read keys with the default key encoding', async function () {
+			let db = open(testDirPath + '/test-keys.mdb', { encoding: 'json' });
+			let keys = [
+				-1.1,
+				0,
+				0.5,
+				3,
+				[5, 4],
+				[5, 'a'],
+				256,
+				1700000000000,
+				'a',
+				['hello', 3],
+				['hello', 'world'],
+				'ünïcödé',
+				'日本語',
+			];
+			for (let key of keys) {
+				db.put(key, { key });
+			}
+			await db.committed;
+			for (let key of keys) {
+				db.get(key).key.should.deep.equal(key);
+			}
+			db.getKeys().asArray.should.deep.equal(keys);
+			await db.close();
+		});
+	});
+	describe('decompressed cache', function () {
+		it('should return current values from the decompressed cache', async function () {
+			let db = open(testDirPath + '/test-decompressed-cache.mdb', {
+				compression: { threshold: 100 },
+				decompressedCacheSize: 0x100000,
+			});
+			let value = expand('cached value');
+			for (let i = 0; i < 10; i++) db.put('key' + i, value + i);
+			await db.committed;
+			for (let j = 0; j < 3; j++) {
+				for (let i = 0; i < 10; i++) db.get('key' + i).should.equal(value + i);
+			}
+			// modified entries must not be served from the cache
+			await db.put('key3', value + 'changed');
+			db.get('key3').should.equal(value + 'changed');
+			await db.transaction(() => {
+				db.put('key4', value + 'in txn');
+				db.get('key4').should.equal(value + 'in txn');
+				db.put('key4', value + 'in txn again');
+				db.get('key4').should.equal(value + 'in txn again');
+			});
+			db.get('key4').should.equal(value + 'in txn again');
+			db.getBinary('key5').toString().should.equal(value + 5);
+			await db.close();
+		});
+	});
+	describe('invalidated cache', function () {
+		it('should invalidate cached entries from committed writes', async function () {
+			let root = open(testDirPath + '/test-invalidated-cache.mdb', {});
+			let cached = root.openDB('cached', { cache: { invalidated: true } });
+			let uncached = root.openDB('cached', {});
+			await uncached.put('a', { value: 1 });
+			let entry = cached.get('a');
+			entry.value.should.equal(1);
+			cached.get('a').should.equal(entry);
+			await uncached.put('a', { value: 2 });
+			cached.get('a').value.should.equal(2);
+			uncached.transactionSync(() => uncached.put('a', { value: 3 }));
+			cached.get('a').value.should.equal(3);
+			await uncached.remove('a');
+			should.equal(cached.get('a'), undefined);
+			await cached.put('b', { value: 4 });
+			cached.get('b').value.should.equal(4);
+			await uncached.clearAsync();
+			should.equal(cached.get('b'), undefined);
+			// the put of an aborted txn is evicted
+			cached.transactionSync(() => {
+				cached.put('c', { value: 5 });
+				return ABORT;
+			});
+			should.equal(cached.get('c'), undefined);
+			await root.close();
+		});
+		it('should clear cached entries when another process commits', async function () {
+			let path = testDirPath + '/test-invalidated-cache-processes.mdb';
+			let root = open(path, {});
+			let cached = root.openDB('cached', { cache: { invalidated: true } });
+			await cached.put('a', { value: 1 });
+			cached.get('a').value.should.equal(1);
+			execFileSync('node', [
+				'--input-type=module',
+				'-e',
+				`import { open } from ${JSON.stringify(new URL('../index.js', import.meta.url).href)};
+				let root = open(${JSON.stringify(path)}, {});
+				await root.openDB('cached', {}).put('a', { value: 2 });
+				await root.close();`,
+			]);
+			// wait for the read txn to be renewed
+			await delay(10);
+			cached.get('a').value.should.equal(2);
+			await root.close();
+		});
 	});
 	describe('uint32 keys', function () {
 		this.timeout(10000);
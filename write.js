@@ -4,12 +4,17 @@ import {
 	write,
 	compress,
 	lmdbError,
+	getWriteQueueStats,
 } from './native.js';
 import { when } from './util/when.js';
 var backpressureArray;
 
 const WAITING_OPERATION = 0x2000000;
-const BACKPRESSURE_THRESHOLD = 300000;
+const BACKPRESSURE_THRESHOLD = 300000; // outstanding writes, until the writer has measured its rate
+const DEFAULT_MAX_QUEUE_DRAIN_TIME = 2000;
+const DEFAULT_MAX_QUEUE_BYTES = 0x10000000;
+// low priority writes are only fed into the write queue while there are fewer outstanding writes than this
+const LOW_PRIORITY_QUEUE_DEPTH = 1000;
 const TXN_DELIMITER = 0x8000000;
 const TXN_COMMITTED = 0x10000000;
 const TXN_FLUSHED = 0x20000000;
@@ -21,6 +26,8 @@ const NO_RESOLVE = 16;
 const HAS_TXN = 8;
 const CONDITIONAL_VERSION_LESS_THAN = 0x800;
 const CONDITIONAL_ALLOW_NOTFOUND = 0x800;
+const DURABILITY_SYNC = 0x200000;
+const DURABILITY_NO_SYNC = 0x400000;
 
 const SYNC_PROMISE_SUCCESS = Promise.resolve(true);
 const SYNC_PROMISE_FAIL = Promise.resolve(false);
@@ -50,6 +57,20 @@ const queueTask =
 //let debugLog = []
 const WRITE_BUFFER_SIZE = 0x10000;
 var log = [];
+// the instruction flag for a durability level: 'sync' fsyncs before the write resolves, 'flush' and 'none' let the
+// writer commit without an fsync (the committed pages are always handed to the OS)
+export function durabilityFlags(durability) {
+	switch (durability) {
+		case undefined:
+			return 0;
+		case 'sync':
+			return DURABILITY_SYNC;
+		case 'flush':
+		case 'none':
+			return DURABILITY_NO_SYNC;
+	}
+	throw new Error('Unknown durability level ' + durability);
+}
 export function addWriteMethods(
 	LMDBStore,
 	{
@@ -65,6 +86,8 @@ export function addWriteMethods(
 		commitDelay,
 		separateFlushed,
 		maxFlushDelay,
+		maxQueueDrainTime,
+		maxQueueBytes,
 	},
 ) {
 	//  stands for write instructions
@@ -97,7 +120,7 @@ export function addWriteMethods(
 	var outstandingWriteCount = 0;
 	var startAddress = 0;
 	var writeTxn = null;
-	var committed;
+	var committed, flushed;
 	var abortedNonChildTransactionWarn;
 	var nextTxnCallbacks = [];
 	var commitPromise,
@@ -112,6 +135,11 @@ export function addWriteMethods(
 	var enqueuedEventTurnBatch;
 	var batchDepth = 0;
 	var lastWritePromise;
+	var batchDurability = 0;
+	var lowPriorityWrites = [],
+		lowPriorityStart = 0,
+		lowPriorityFeed,
+		lowPriorityCommitted;
 	var writeBatchStart,
 		outstandingBatchCount,
 		lastSyncTxnFlush,
@@ -121,6 +149,13 @@ export function addWriteMethods(
 	txnStartThreshold = txnStartThreshold || 5;
 	batchStartThreshold = batchStartThreshold || 1000;
 	maxFlushDelay = maxFlushDelay || 500;
+	maxQueueDrainTime = maxQueueDrainTime || DEFAULT_MAX_QUEUE_DRAIN_TIME;
+	maxQueueBytes = maxQueueBytes || DEFAULT_MAX_QUEUE_BYTES;
+	// the writer's progress: instructions processed, instructions per ms and ms per commit
+	var writeQueueStats = new Float64Array(getWriteQueueStats(env.address));
+	var queuedWriteCount = 0,
+		pendingBytes = 0,
+		backpressureResolvers = [];
 
 	allocateInstructionBuffer();
 	dynamicBytes.uint32[2] = TXN_DELIMITER | TXN_COMMITTED | TXN_FLUSHED;
@@ -130,6 +165,7 @@ export function addWriteMethods(
 			flagPosition: 2,
 			flag: 0,
 			valueBuffer: null,
+			valueSize: 0,
 			next: null,
 			meta: null,
 		};
@@ -138,6 +174,7 @@ export function addWriteMethods(
 		flagPosition: 2,
 		flag: 0,
 		valueBuffer: null,
+		valueSize: 0,
 		next: nextResolution,
 		meta: null,
 	};
@@ -146,6 +183,8 @@ export function addWriteMethods(
 	var lastQueuedResolution = uncommittedResolution;
 	function writeInstructions(flags, store, key, value, version, ifVersion) {
 		let writeStatus;
+		if (!(flags & (DURABILITY_SYNC | DURABILITY_NO_SYNC)))
+			flags |= batchDurability || store.durabilityFlags || 0;
 		let targetBytes, position, encoder;
 		let valueSize, valueBuffer, valueBufferStart;
 		if (flags & 2) {
@@ -347,6 +386,7 @@ export function addWriteMethods(
 			flagPosition: position << 1,
 			flag: 0, // TODO: eventually eliminate this, as we can probably signify HAS_TXN/NO_RESOLVE/FAILED_CONDITION in upper bits
 			valueBuffer: fixedBuffer, // these are all just placeholders so that we have the right hidden class initially allocated
+			valueSize: 0,
 			next: null,
 			meta: null,
 		};
@@ -383,6 +423,9 @@ export function addWriteMethods(
 			else writeStatus = Atomics.or(uint32, flagPosition, flags);
 
 			outstandingWriteCount++;
+			queuedWriteCount++;
+			pendingBytes += valueSize;
+			resolution.valueSize = valueSize;
 			if (writeStatus & TXN_DELIMITER) {
 				commitPromise = null; // TODO: Don't reset these if this comes from the batch start operation on an event turn batch
 				flushPromise = null;
@@ -409,15 +452,14 @@ export function addWriteMethods(
 				// write thread is waiting
 				write(env.address, 0);
 			}
-			if (outstandingWriteCount > BACKPRESSURE_THRESHOLD && !writeBatchStart) {
-				if (!backpressureArray)
-					backpressureArray = new Int32Array(new SharedArrayBuffer(4), 0, 1);
-				Atomics.wait(
-					backpressureArray,
-					0,
-					0,
-					Math.round(outstandingWriteCount / BACKPRESSURE_THRESHOLD),
-				);
+			if (!writeBatchStart) {
+				let load = queueLoad();
+				if (load > 1) {
+					// slow the producer down in proportion to how far the writer is behind
+					if (!backpressureArray)
+						backpressureArray = new Int32Array(new SharedArrayBuffer(4), 0, 1);
+					Atomics.wait(backpressureArray, 0, 0, Math.round(load));
+				}
 			}
 			if (startAddress) {
 				if (eventTurnBatching)
@@ -470,7 +512,7 @@ export function addWriteMethods(
 							? flushPromise
 							: commitPromise;
 				}
-				return commitPromise;
+				return flags & DURABILITY_SYNC ? afterFlush(commitPromise) : commitPromise;
 			}
 			lastWritePromise = new Promise((resolve, reject) => {
 				let meta = resolution.meta || (resolution.meta = {});
@@ -481,9 +523,100 @@ export function addWriteMethods(
 				lastWritePromise.flushed = overlappingSync
 					? flushPromise
 					: lastWritePromise;
-			return lastWritePromise;
+			return flags & DURABILITY_SYNC ? afterFlush(lastWritePromise) : lastWritePromise;
 		};
 	}
+	function queueLowPriority(flags, store, key, value, version, ifVersion, callback) {
+		if (flags & 2) {
+			// encode now, with a copy since encoders reuse their buffers, so later changes to the value aren't written
+			let encoder = store.encoder;
+			let bytes =
+				(value && value['\x10binary-data\x02']) ||
+				(encoder ? encoder.encode(value) : value);
+			if (typeof bytes == 'string' || bytes instanceof Uint8Array)
+				value = { '\x10binary-data\x02': Buffer.from(bytes) };
+		}
+		let write = { flags, store, key, value, version, ifVersion, callback };
+		let promise = new Promise((resolve, reject) => {
+			write.resolve = resolve;
+			write.reject = reject;
+		});
+		// the writes are fed in order, so once the last one is committed, all the queued writes are
+		lowPriorityCommitted = promise.then(
+			() => {},
+			() => {},
+		);
+		lowPriorityWrites.push(write);
+		if (!lowPriorityFeed) lowPriorityFeed = queueTask(feedLowPriorityWrites);
+		if (typeof callback != 'function') return promise;
+	}
+	function feedLowPriorityWrites(all) {
+		// move queued low priority writes (in order) into the write queue, leaving room for the other writes to be
+		// committed in the next txn, rather than behind all the low priority writes
+		lowPriorityFeed = null;
+		if (writeTxn && all !== true) return; // an async txn callback is still running, fed again once it is committed
+		while (
+			lowPriorityStart < lowPriorityWrites.length &&
+			(all === true || outstandingWriteCount < LOW_PRIORITY_QUEUE_DEPTH)
+		) {
+			let write = lowPriorityWrites[lowPriorityStart];
+			lowPriorityWrites[lowPriorityStart++] = null;
+			let callback = write.callback;
+			try {
+				let result = writeInstructions(
+					write.flags,
+					write.store,
+					write.key,
+					write.value,
+					write.version,
+					write.ifVersion,
+				)(
+					typeof callback == 'function'
+						? (error, value) => {
+								callback(error, value);
+								write.resolve(); // only used to know it has been committed
+							}
+						: callback,
+				);
+				if (result) result.then(write.resolve, write.reject);
+			} catch (error) {
+				write.reject(error);
+				if (typeof write.callback == 'function') write.callback(error);
+			}
+		}
+		if (lowPriorityStart === lowPriorityWrites.length) {
+			lowPriorityWrites = [];
+			lowPriorityStart = 0;
+		} else if (lowPriorityStart > LOW_PRIORITY_QUEUE_DEPTH) {
+			lowPriorityWrites = lowPriorityWrites.slice(lowPriorityStart);
+			lowPriorityStart = 0;
+		}
+	}
+	function queueDepth() {
+		return Math.max(queuedWriteCount - writeQueueStats[0], 0);
+	}
+	function estimatedDrainTime() {
+		// the time for the writer to write the queued instructions and commit them
+		let rate = writeQueueStats[1];
+		return rate ? queueDepth() / rate + writeQueueStats[2] : undefined;
+	}
+	function queueLoad() {
+		// how full the write queue is relative to its limits, where more than 1 calls for backpressure
+		let drainTime = estimatedDrainTime();
+		return Math.max(
+			drainTime === undefined
+				? outstandingWriteCount / BACKPRESSURE_THRESHOLD
+				: drainTime / maxQueueDrainTime,
+			pendingBytes / maxQueueBytes,
+		);
+	}
+	function afterFlush(promise) {
+		// with overlapping sync, the flush is tracked separately from the commit, so a write that requires an
+		// fsync resolves once its txn is flushed
+		if (!overlappingSync || !flushPromise) return promise;
+		let flushed = flushPromise;
+		return promise.then((result) => flushed.then(() => result));
+	}
 	let committedFlushResolvers,
 		lastSync = Promise.resolve();
 	function startWriting() {
@@ -498,6 +631,12 @@ export function addWriteMethods(
 				queueCommitResolution(nextResolution);
 
 			resolveWrites(true);
+			if (lowPriorityStart < lowPriorityWrites.length && !lowPriorityFeed)
+				lowPriorityFeed = queueTask(feedLowPriorityWrites);
+			if (backpressureResolvers.length > 0 && queueLoad() <= 1) {
+				for (let resolve of backpressureResolvers) resolve(true);
+				backpressureResolvers = [];
+			}
 			switch (status) {
 				case 0:
 					for (let resolver of resolvers) {
@@ -549,6 +688,7 @@ export function addWriteMethods(
 				unwrittenResolution.callbacks = null;
 			}
 			outstandingWriteCount--;
+			pendingBytes -= unwrittenResolution.valueSize;
 			if (unwrittenResolution.flag !== HAS_TXN) {
 				if (
 					unwrittenResolution.flag === NO_RESOLVE &&
@@ -731,6 +871,7 @@ export function addWriteMethods(
 	Object.assign(LMDBStore.prototype, {
 		put(key, value, versionOrOptions, ifVersion) {
 			let callback,
+				priority,
 				flags = 15,
 				type = typeof versionOrOptions;
 			if (type == 'object' && versionOrOptions) {
@@ -738,6 +879,9 @@ export function addWriteMethods(
 				if (versionOrOptions.noDupData) flags |= 0x20;
 				if (versionOrOptions.instructedWrite) flags |= 0x2000;
 				if (versionOrOptions.append) flags |= 0x20000;
+				if (versionOrOptions.durability)
+					flags |= durabilityFlags(versionOrOptions.durability);
+				priority = versionOrOptions.priority;
 				if (versionOrOptions.ifVersion != undefined)
 					ifVersion = versionOrOptions.ifVersion;
 				versionOrOptions = versionOrOptions.version;
@@ -745,6 +889,20 @@ export function addWriteMethods(
 			} else if (type == 'function') {
 				callback = versionOrOptions;
 			}
+			if (
+				(priority || this.priority) === 'low' &&
+				!writeTxn &&
+				batchDepth < 2 // writes in a batch stay together
+			)
+				return queueLowPriority(
+					flags,
+					this,
+					key,
+					value,
+					this.useVersions ? versionOrOptions || 0 : undefined,
+					ifVersion,
+					callback,
+				);
 			return writeInstructions(
 				flags,
 				this,
@@ -768,6 +926,8 @@ export function addWriteMethods(
 					value = ifVersionOrValue;
 				}
 			}
+			if (this.priority === 'low' && !writeTxn && batchDepth < 2)
+				return queueLowPriority(flags, this, key, value, undefined, ifVersion, callback);
 			return writeInstructions(
 				flags,
 				this,
@@ -801,6 +961,7 @@ export function addWriteMethods(
 			let flags = key === undefined || version === undefined ? 1 : 4;
 			if (options?.ifLessThan) flags |= CONDITIONAL_VERSION_LESS_THAN;
 			if (options?.allowNotFound) flags |= CONDITIONAL_ALLOW_NOTFOUND;
+			if (options?.durability) flags |= durabilityFlags(options.durability);
 			let finishStartWrite = writeInstructions(
 				flags,
 				this,
@@ -810,6 +971,9 @@ export function addWriteMethods(
 				version,
 			);
 			let promise;
+			let lastBatchDurability = batchDurability;
+			// writes in the batch carry its durability level, unless they have their own
+			if (options?.durability) batchDurability = flags & (DURABILITY_SYNC | DURABILITY_NO_SYNC);
 			batchDepth += 2;
 			if (batchDepth > 2) promise = finishStartWrite();
 			else {
@@ -828,6 +992,7 @@ export function addWriteMethods(
 					}
 				}
 			} finally {
+				batchDurability = lastBatchDurability;
 				if (!promise) {
 					finishBatch();
 					batchDepth -= 2;
@@ -840,8 +1005,8 @@ export function addWriteMethods(
 			}
 			return promise;
 		},
-		batch(callbackOrOperations) {
-			return this.ifVersion(undefined, undefined, callbackOrOperations);
+		batch(callbackOrOperations, options) {
+			return this.ifVersion(undefined, undefined, callbackOrOperations, options);
 		},
 		drop(callback) {
 			return writeInstructions(
@@ -894,6 +1059,33 @@ export function addWriteMethods(
 					overlappingSync ? 0x10002 : 2,
 				); // non-abortable, async flush
 		},
+		bulkLoad(entries, options) {
+			let fillFactor = options?.fillFactor;
+			let load = () => {
+				if (fillFactor) env.setWriteFill(fillFactor);
+				let count = 0;
+				for (let { key, value, version } of entries) {
+					// appending skips the search for each key, and fills pages rather than splitting them in half
+					if (
+						this.put(key, value, { append: true, version }) !==
+						SYNC_PROMISE_SUCCESS
+					)
+						throw new Error(
+							'Bulk loaded entries must be in sorted order, after any existing keys',
+						);
+					count++;
+				}
+				return count;
+			};
+			if (writeTxn) {
+				try {
+					return load();
+				} finally {
+					if (fillFactor) env.setWriteFill(100); // restore for the rest of the transaction
+				}
+			}
+			return this.transactionSync(load, overlappingSync ? 0x10002 : 2);
+		},
 		transaction(callback) {
 			if (writeTxn && !nextTxnCallbacks.isExecuting) {
 				// already nested in a transaction, just execute and return
@@ -1033,12 +1225,27 @@ export function addWriteMethods(
 		getWriteTxnId() {
 			return env.getWriteTxnId();
 		},
+		getWriteQueueStats() {
+			return {
+				queueDepth: queueDepth() + lowPriorityWrites.length - lowPriorityStart,
+				bytesPending: pendingBytes,
+				estimatedDrainTime: estimatedDrainTime(),
+			};
+		},
+		backpressure() {
+			// for producers that can wait, rather than being blocked by the backpressure on each write
+			if (queueLoad() <= 1) return SYNC_PROMISE_SUCCESS;
+			return new Promise((resolve) => backpressureResolvers.push(resolve));
+		},
 		transactionSyncStart(callback) {
 			return this.transactionSync(callback, 0);
 		},
 		// make the db a thenable/promise-like for when the last commit is committed
 		committed: (committed = {
 			then(onfulfilled, onrejected) {
+				if (lowPriorityStart < lowPriorityWrites.length)
+					// wait for the queued low priority writes, and then whatever is committing after them
+					return lowPriorityCommitted.then(() => committed.then(onfulfilled, onrejected));
 				if (commitPromise) return commitPromise.then(onfulfilled, onrejected);
 				if (lastWritePromise)
 					// always resolve to true
@@ -1046,17 +1253,20 @@ export function addWriteMethods(
 				return SYNC_PROMISE_SUCCESS.then(onfulfilled, onrejected);
 			},
 		}),
-		flushed: {
+		flushed: (flushed = {
 			// make this a thenable for when the commit is flushed to disk
 			then(onfulfilled, onrejected) {
+				if (lowPriorityStart < lowPriorityWrites.length)
+					return lowPriorityCommitted.then(() => flushed.then(onfulfilled, onrejected));
 				if (flushPromise) flushPromise.hasCallbacks = true;
 				return Promise.all([flushPromise || committed, lastSyncTxnFlush]).then(
 					onfulfilled,
 					onrejected,
 				);
 			},
-		},
+		}),
 		_endWrites(resolvedPromise, resolvedSyncPromise) {
+			if (lowPriorityStart < lowPriorityWrites.length) feedLowPriorityWrites(true);
 			this.put =
 				this.remove =
 				this.del =